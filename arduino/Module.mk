@@ -23,6 +23,9 @@ ifdef BOARD_UUID
     CPPFLAGS += -DBOARD_UUID=\"$(BOARD_UUID)\"
 endif
 
+# SerialTalks relies on C++11 to check the instructions tables at compile time
+CXXFLAGS_STD = -std=gnu++11
+
 # Guess MONITOR_PORT if not specified
 ifndef MONITOR_PORT
     MONITOR_PORT = /dev/arduino/$(BOARD_UUID)
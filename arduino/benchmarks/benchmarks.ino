@@ -0,0 +1,364 @@
+// Microbenchmarks of the control kernels of the wheeledbase.
+//
+// On the ATmega328P (or under simavr, see the makefile) each kernel runs once and its exact
+// duration is printed in CPU cycles. On the host (see ../CMakeLists.txt) each kernel runs many
+// times and its mean duration is printed in nanoseconds. In both cases the lines look like:
+//
+//   <kernel> <duration> <unit>
+//
+// compare.py checks the host ones against the committed baselines. Then the accuracy report compares the
+// fastmath.h approximations with the libm functions they replace:
+//
+//   <function> max error <error>
+
+#include <Arduino.h>
+
+#include "../wheeledbase/PIN.h"
+#include "../wheeledbase/constants.h"
+
+#include "../common/Fixed.h"
+#include "../common/PID.h"
+#include "../common/Odometry.h"
+#include "../common/Codewheel.h"
+#include "../common/VelocityController.h"
+#include "../common/PositionController.h"
+#include "../common/PurePursuit.h"
+#include "../common/mathutils.h"
+#include "../common/fastmath.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#endif
+
+#define BENCHMARKS_HOST_ITERATIONS 100000
+#define BENCHMARKS_HOST_BATCHES    10
+#define BENCHMARKS_ACCURACY_SAMPLES 10007
+
+// Expose the kernels that are not public
+
+class BenchmarkOdometry : public Odometry
+{
+public:
+
+	using Odometry::process;
+};
+
+class BenchmarkVelocityController : public VelocityController
+{
+public:
+
+	using VelocityController::genRampSetpoint;
+};
+
+class BenchmarkPurePursuit : public PurePursuit
+{
+public:
+
+	using PurePursuit::computeVelSetpoints;
+};
+
+class BenchmarkCodewheel : public Codewheel
+{
+public:
+
+	using Codewheel::update;
+};
+
+class ConstantCodewheel : public AbstractCodewheel
+{
+public:
+
+	ConstantCodewheel(float distance) : m_distance(distance){}
+
+	virtual float getTraveledDistance(){return m_distance;}
+	virtual float restart(){return m_distance;}
+
+private:
+
+	volatile float m_distance;
+};
+
+// Kernels inputs and outputs. They are volatile so that the compiler can't hoist the computations
+// out of the benchmarks loops.
+
+volatile float setpoint = 300;
+volatile float input    = 287.5;
+volatile float timestep = PID_CONTROLLERS_TIMESTEP;
+volatile float output;
+
+volatile float angle = 2.4;
+volatile float dx    = -135.2;
+volatile float dy    = 87.9;
+
+volatile int32_t fixedSetpoint = Fixed(300.0f).getRaw();
+volatile int32_t fixedInput    = Fixed(287.5f).getRaw();
+volatile int32_t fixedTimestep = Fixed(float(PID_CONTROLLERS_TIMESTEP)).getRaw();
+volatile int32_t fixedOutput;
+
+const Fixed fixedMaxAcc = Fixed(float(MAX_LINEAR_ACCELERATION));
+const Fixed fixedMaxDec = Fixed(float(MAX_LINEAR_DECCELERATION));
+
+PIDController<float> pid;
+PIDController<Fixed> fixedPID;
+
+BenchmarkVelocityController velocityControl;
+
+ConstantCodewheel leftCodewheel (1.02);
+ConstantCodewheel rightCodewheel(1.17);
+BenchmarkOdometry odometry;
+
+PositionController   positionControl;
+BenchmarkPurePursuit purePursuit;
+
+BenchmarkCodewheel codewheel;
+
+// Kernels
+
+void emptyKernel()
+{
+}
+
+void pidComputeKernel()
+{
+	output = pid.compute(setpoint, input, timestep);
+}
+
+void genRampSetpointKernel()
+{
+	output = velocityControl.genRampSetpoint<float>(setpoint, input, output, MAX_LINEAR_ACCELERATION, MAX_LINEAR_DECCELERATION, timestep);
+}
+
+void fixedPIDComputeKernel()
+{
+	fixedOutput = fixedPID.compute(Fixed::fromRaw(fixedSetpoint), Fixed::fromRaw(fixedInput), Fixed::fromRaw(fixedTimestep)).getRaw();
+}
+
+void fixedGenRampSetpointKernel()
+{
+	fixedOutput = velocityControl.genRampSetpoint<Fixed>(Fixed::fromRaw(fixedSetpoint), Fixed::fromRaw(fixedInput), Fixed::fromRaw(fixedOutput), fixedMaxAcc, fixedMaxDec, Fixed::fromRaw(fixedTimestep)).getRaw();
+}
+
+void odometryProcessKernel()
+{
+	odometry.process(ODOMETRY_TIMESTEP);
+}
+
+void purePursuitKernel()
+{
+	purePursuit.computeVelSetpoints(POSITIONCONTROL_TIMESTEP);
+}
+
+void codewheelUpdateKernel()
+{
+	codewheel.update();
+}
+
+void sinKernel()      {output = sin(angle);}
+void fastsinKernel()  {output = fastsin(angle);}
+void cosKernel()      {output = cos(angle);}
+void fastcosKernel()  {output = fastcos(angle);}
+void atan2Kernel()    {output = atan2(dy, dx);}
+void fastatan2Kernel(){output = fastatan2(dy, dx);}
+void sqrtKernel()     {output = sqrt(dx * dx + dy * dy);}
+void fastsqrtKernel() {output = fastsqrt(dx * dx + dy * dy);}
+void inrangeKernel()  {output = inrange(dx, -M_PI, M_PI);}
+void fastwrapKernel() {output = fastwrap(dx);}
+
+struct Benchmark
+{
+	const char* name;
+	void (*kernel)();
+};
+
+const Benchmark benchmarks[] =
+{
+	{"PID::compute",                              pidComputeKernel},
+	{"VelocityController::genRampSetpoint",       genRampSetpointKernel},
+	{"PID::compute_fixed",                        fixedPIDComputeKernel},
+	{"VelocityController::genRampSetpoint_fixed", fixedGenRampSetpointKernel},
+	{"Odometry::process",                         odometryProcessKernel},
+	{"PurePursuit::computeVelSetpoints",          purePursuitKernel},
+	{"Codewheel::update",                         codewheelUpdateKernel},
+	{"sin",                                       sinKernel},
+	{"fastsin",                                   fastsinKernel},
+	{"cos",                                       cosKernel},
+	{"fastcos",                                   fastcosKernel},
+	{"atan2",                                     atan2Kernel},
+	{"fastatan2",                                 fastatan2Kernel},
+	{"sqrt",                                      sqrtKernel},
+	{"fastsqrt",                                  fastsqrtKernel},
+	{"inrange",                                   inrangeKernel},
+	{"fastwrap",                                  fastwrapKernel},
+};
+
+// Measurements
+
+#ifdef __AVR__
+
+volatile unsigned int timer1Overflows;
+
+ISR(TIMER1_OVF_vect)
+{
+	timer1Overflows++;
+}
+
+// Duration of one run in CPU cycles. Timer1 counts them without prescaler and its overflows are
+// counted by the interrupt above, which adds about 30 cycles per 65536 ones. Timer0 is paused so
+// that the millis() interrupt doesn't fire meanwhile.
+float measure(void (*kernel)())
+{
+	Serial.flush();
+	const byte timsk0 = TIMSK0;
+	TIMSK0 = 0;
+	TCCR1A = 0;
+	TCCR1B = 0;
+	TCNT1  = 0;
+	TIFR1  = _BV(TOV1);
+	TIMSK1 = _BV(TOIE1);
+	timer1Overflows = 0;
+
+	TCCR1B = _BV(CS10);
+	kernel();
+	TCCR1B = 0;
+
+	cli();
+	unsigned long cycles = ((unsigned long)(timer1Overflows + bitRead(TIFR1, TOV1)) << 16) | TCNT1;
+	sei();
+	TIMSK1 = 0;
+	TIMSK0 = timsk0;
+	return cycles;
+}
+
+#define BENCHMARKS_UNIT "cycles"
+
+#else
+
+// Mean duration of one run in nanoseconds, in the fastest of several batches to filter out the
+// noise of the other processes
+float measure(void (*kernel)())
+{
+	float duration = INFINITY;
+	for (int batch = 0; batch < BENCHMARKS_HOST_BATCHES; batch++)
+	{
+		unsigned long startTime = micros();
+		for (long i = 0; i < BENCHMARKS_HOST_ITERATIONS; i++)
+			kernel();
+		duration = min(duration, (micros() - startTime) * 1000.0f / BENCHMARKS_HOST_ITERATIONS);
+	}
+	return duration;
+}
+
+#define BENCHMARKS_UNIT "ns"
+
+#endif // __AVR__
+
+// Accuracy of the approximations. The sweeps span the ranges the control loops use.
+
+float sinError(float x)  {return abs(fastsin(x) - sin(x));}
+float cosError(float x)  {return abs(fastcos(x) - cos(x));}
+float sqrtError(float x) {float y = pow(10, x); return abs(fastsqrt(y) / sqrt(y) - 1);} // relative
+float wrapError(float x) {return abs(inrange(fastwrap(x) - inrange(x, -M_PI, M_PI), -M_PI, M_PI));}
+
+float atan2Error(float x)
+{
+	// Around circles of several radii
+	const float radius = pow(10, floor(x / (2 * M_PI)));
+	const float y = radius * sin(x);
+	x = radius * cos(x);
+	return abs(inrange(fastatan2(y, x) - atan2(y, x), -M_PI, M_PI));
+}
+
+struct Accuracy
+{
+	const char* name;
+	float (*error)(float);
+	float min, max;
+};
+
+const Accuracy accuracies[] =
+{
+	{"fastsin",   sinError,   -100, 100},
+	{"fastcos",   cosError,   -100, 100},
+	{"fastatan2", atan2Error, -4 * M_PI, 4 * M_PI},
+	{"fastsqrt",  sqrtError,  -3, 7},
+	{"fastwrap",  wrapError,  -100, 100},
+};
+
+float maxError(const Accuracy& accuracy)
+{
+	float error = 0;
+	for (long i = 0; i < BENCHMARKS_ACCURACY_SAMPLES; i++)
+	{
+		const float x = accuracy.min + (accuracy.max - accuracy.min) * i / (BENCHMARKS_ACCURACY_SAMPLES - 1);
+		error = max(error, accuracy.error(x));
+	}
+	return error;
+}
+
+// Setup
+
+void setup()
+{
+	Serial.begin(115200);
+
+	pid.setTunings(1.5, 15, 0.01);
+	pid.setOutputLimits(-800, 800);
+	pid.reset();
+	fixedPID.setTunings(1.5, 15, 0.01);
+	fixedPID.setOutputLimits(-800, 800);
+	fixedPID.reset();
+
+	odometry.setCodewheels(leftCodewheel, rightCodewheel);
+	odometry.setAxleTrack(CODEWHEELS_AXLE_TRACK);
+	odometry.setSlippage(0);
+	odometry.setPosition(0, 0, 0.3);
+
+	// A zigzag path of PUREPURSUIT_MAX_WAYPOINTS waypoints with the robot at its start, so that
+	// the remaining distance spans all the segments
+	purePursuit.reset();
+	for (int i = 0; i < PUREPURSUIT_MAX_WAYPOINTS; i++)
+		purePursuit.addWaypoint(PurePursuit::Waypoint(100 * i, (i % 2) * 80));
+	purePursuit.setDirection(PurePursuit::FORWARD);
+	purePursuit.setFinalAngle(0);
+	purePursuit.setLookAhead(150);
+	purePursuit.setLookAheadBis(50);
+	positionControl.setVelTunings(2, 4);
+	positionControl.setVelLimits(MAX_LINEAR_VELOCITY, MAX_ANGULAR_VELOCITY);
+	positionControl.setPosThresholds(MIN_LINEAR_POSITION, MIN_ANGULAR_POSITION);
+	positionControl.setMoveStrategy(purePursuit);
+	positionControl.setPosInput(Position(-10, 5, 0.1));
+
+	codewheel.attachCounter(QUAD_COUNTER_XY, QUAD_COUNTER_X_AXIS, QUAD_COUNTER_SEL1, QUAD_COUNTER_SEL2, QUAD_COUNTER_OE, QUAD_COUNTER_RST_X);
+	codewheel.attachRegister(SHIFT_REG_DATA, SHIFT_REG_LATCH, SHIFT_REG_CLOCK);
+
+	const float overhead = measure(emptyKernel);
+	for (unsigned int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+	{
+		benchmarks[i].kernel(); // Warm up
+		float duration = measure(benchmarks[i].kernel) - overhead;
+		Serial.print(benchmarks[i].name);
+		Serial.print(' ');
+		Serial.print(duration, 1);
+		Serial.println(" " BENCHMARKS_UNIT);
+	}
+	for (unsigned int i = 0; i < sizeof(accuracies) / sizeof(accuracies[0]); i++)
+	{
+		Serial.print(accuracies[i].name);
+		Serial.print(" max error ");
+		Serial.println(maxError(accuracies[i]), 8);
+	}
+	Serial.flush();
+
+#ifdef __AVR__
+	// Sleeping with the interrupts disabled makes simavr exit
+	cli();
+	sleep_mode();
+#endif
+}
+
+// Loop
+
+void loop()
+{
+}
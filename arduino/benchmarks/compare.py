@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+#-*- coding: utf-8 -*-
+
+# Check the output of the benchmarks sketch against the committed baselines:
+#
+#   python3 compare.py results.txt [--update]
+#
+# It fails if a kernel got slower than its baseline by more than the tolerance. The host durations
+# depend on the machine and its load so this is only a rough guard. The AVR cycle counts are not
+# checked: none was ever measured to compare them with.
+
+import argparse
+import os
+import re
+import sys
+
+BASELINE_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'baseline.txt')
+
+TOLERANCE = 0.50
+
+RESULT_PATTERN = re.compile(r'([A-Za-z_][\w:]*) (\d+(?:\.\d+)?) ns\s*$')
+
+
+def read_results(path):
+	results = dict()
+	with open(path) as file:
+		for line in file:
+			match = RESULT_PATTERN.search(line)
+			if match is not None:
+				results[match.group(1)] = float(match.group(2))
+	return results
+
+
+def read_baseline(path=BASELINE_PATH):
+	header, baseline = [], dict()
+	with open(path) as file:
+		for line in file:
+			if line.startswith('#') or not line.strip():
+				header.append(line)
+				continue
+			name, value = line.split()
+			baseline[name] = float(value)
+	return header, baseline
+
+
+def write_baseline(header, baseline, path=BASELINE_PATH):
+	with open(path, 'w') as file:
+		file.writelines(header)
+		for name, value in baseline.items():
+			file.write('{:<44}{:>12.1f}\n'.format(name, value))
+
+
+if __name__ == '__main__':
+	parser = argparse.ArgumentParser(description='Compare benchmark results with the baselines.')
+	parser.add_argument('results', help='output of the benchmarks sketch')
+	parser.add_argument('--tolerance', type=float, default=TOLERANCE, help='allowed relative slowdown (default: {})'.format(TOLERANCE))
+	parser.add_argument('--update', action='store_true', help='replace the baselines with the results')
+	args = parser.parse_args()
+
+	results = read_results(args.results)
+	if not results:
+		sys.exit('no host results in {}'.format(args.results))
+	header, baseline = read_baseline()
+
+	if args.update:
+		baseline.update(results)
+		write_baseline(header, baseline)
+		print('updated the baselines of {} kernels'.format(len(results)))
+		sys.exit()
+
+	tolerance = args.tolerance
+	failures = 0
+	for name, duration in results.items():
+		reference = baseline.get(name)
+		if reference is None:
+			status = 'no baseline'
+		else:
+			change = duration / reference - 1
+			status = '{:+.1%}'.format(change)
+			if change > tolerance:
+				status += ' REGRESSION'
+				failures += 1
+		print('{:<44}{:>12.1f} ns     {}'.format(name, duration, status))
+	if failures > 0:
+		sys.exit('{} kernels are more than {:.0%} slower than their baseline'.format(failures, tolerance))
@@ -4,30 +4,43 @@
 #include <Arduino.h>
 
 
+// Measures durations with micros(). They are 32-bit unsigned subtractions, as on the AVR even on
+// the host, so they stay right across the rollover of micros() every 71.6 minutes as long as each
+// one is shorter than that. Prefer the integer methods in the loops: the float ones cost a conversion and a
+// multiplication each, which is hundreds of cycles on the AVR.
+
 class Clock
 {
 public:
 
 	Clock() : m_startTime(micros()){}
 
+	uint32_t getElapsedMicros() const
+	{
+		return micros() - m_startTime;
+	}
+
+	uint32_t restartMicros()
+	{
+		uint32_t currentTime = micros();
+		uint32_t elapsedTime = currentTime - m_startTime;
+		m_startTime = currentTime;
+		return elapsedTime;
+	}
+
 	float getElapsedTime() const
 	{
-		unsigned long currentTime = micros();
-		float elapsedTimeInSeconds = (currentTime - m_startTime) / float(1e6);
-		return elapsedTimeInSeconds;
+		return getElapsedMicros() * float(1e-6);
 	}
 
 	float restart()
 	{
-		unsigned long currentTime = micros();
-		float elapsedTimeInSeconds = (currentTime - m_startTime) / float(1e6);
-		m_startTime = currentTime;
-		return elapsedTimeInSeconds;
+		return restartMicros() * float(1e-6);
 	}
 
 private:
 
-	unsigned long m_startTime;
+	uint32_t m_startTime;
 };
 
 #endif // __CLOCK_H__
@@ -8,8 +8,8 @@
 void DifferentialController::process(float timestep)
 {
 	// Compute linear and angular velocities outputs
-	m_linVelOutput = m_linPID->compute(m_linSetpoint, m_linInput, timestep);
-	m_angVelOutput = m_angPID->compute(m_angSetpoint, m_angInput, timestep);
+	m_linVelOutput = float(m_linPID->compute(m_linSetpoint, m_linInput, timestep));
+	m_angVelOutput = float(m_angPID->compute(m_angSetpoint, m_angInput, timestep));
 
 	// Convert linear and angular velocities into wheels' velocities
 	m_leftWheel ->setVelocity(m_linVelOutput - m_angVelOutput * m_axleTrack / 2);
@@ -33,6 +33,10 @@ public:
 
 	float getLinSetpoint() const {return m_linSetpoint;}
 	float getAngSetpoint() const {return m_angSetpoint;}
+	float getLinInput()    const {return m_linInput;}
+	float getAngInput()    const {return m_angInput;}
+	float getLinVelOutput() const {return m_linVelOutput;}
+	float getAngVelOutput() const {return m_angVelOutput;}
 
 	float getAxleTrack() const {return m_axleTrack;}
 
@@ -0,0 +1,119 @@
+#ifndef __FIXED_H__
+#define __FIXED_H__
+
+#include <stdint.h>
+#include <math.h>
+
+
+// Signed Q16.16 fixed-point number: 1.5e-5 resolution, [-32768, 32768[ range.
+//
+// The AVR has no FPU: the float operations are software routines of hundreds of cycles, while
+// these are 32-bit integer ones. The arithmetic saturates instead of wrapping around, and the
+// conversions from float saturate too (so INFINITY becomes the largest value).
+
+class Fixed
+{
+public:
+
+	static const int32_t RAW_ONE = 0x10000;
+	static const int32_t RAW_MAX = INT32_MAX;
+	static const int32_t RAW_MIN = INT32_MIN;
+
+	Fixed() : m_raw(0){}
+	Fixed(float value) : m_raw(fromFloat(value)){}
+	Fixed(int value) : m_raw(saturate((int64_t)(value) * RAW_ONE)){}
+
+	static Fixed fromRaw(int32_t raw){Fixed x; x.m_raw = raw; return x;}
+	static Fixed max(){return fromRaw(RAW_MAX);}
+	static Fixed min(){return fromRaw(RAW_MIN);}
+
+	int32_t getRaw() const {return m_raw;}
+
+	explicit operator float() const {return m_raw / float(RAW_ONE);}
+
+	Fixed operator-() const {return fromRaw(m_raw == RAW_MIN ? RAW_MAX : -m_raw);}
+
+	Fixed operator+(Fixed other) const
+	{
+		int32_t raw = (int32_t)((uint32_t)(m_raw) + (uint32_t)(other.m_raw));
+		if (((m_raw ^ raw) & (other.m_raw ^ raw)) < 0) // Both operands have the sign the sum hasn't
+			raw = (m_raw < 0) ? RAW_MIN : RAW_MAX;
+		return fromRaw(raw);
+	}
+
+	Fixed operator-(Fixed other) const {return *this + (-other);}
+
+	// The 64-bit multiplication is a library call on the AVR, so it does with 16x16-bit partial
+	// products there. Both ways round towards zero.
+	Fixed operator*(Fixed other) const
+	{
+#ifdef __AVR__
+		const bool negative = (m_raw < 0) != (other.m_raw < 0);
+		const uint32_t limit = negative ? (uint32_t)(RAW_MAX) + 1 : RAW_MAX;
+		const uint32_t a = (m_raw < 0) ? -(uint32_t)(m_raw) : m_raw;
+		const uint32_t b = (other.m_raw < 0) ? -(uint32_t)(other.m_raw) : other.m_raw;
+		const uint16_t ah = a >> 16, al = a;
+		const uint16_t bh = b >> 16, bl = b;
+
+		// Each step stays below 2^32 as long as the previous one is within the limit
+		uint32_t raw = (uint32_t)(ah) * bh;
+		if (raw >= 0x8000)
+			return negative ? min() : max();
+		raw = (raw << 16) + (((uint32_t)(al) * bl) >> 16);
+		raw += (uint32_t)(ah) * bl;
+		if (raw > limit)
+			return negative ? min() : max();
+		raw += (uint32_t)(al) * bh;
+		if (raw > limit)
+			return negative ? min() : max();
+		return fromRaw(negative ? -(int32_t)(raw - 1) - 1 : (int32_t)(raw));
+#else
+		return fromRaw(saturate(((int64_t)(m_raw) * other.m_raw) / RAW_ONE));
+#endif // __AVR__
+	}
+
+	// 1 / x, with a 32-bit division only (the 64-bit ones are very slow on the AVR)
+	Fixed reciprocal() const
+	{
+		if (m_raw == 0)
+			return max();
+		const uint32_t magnitude = (m_raw < 0) ? -(uint32_t)(m_raw) : m_raw;
+		if (magnitude == 1)
+			return (m_raw < 0) ? min() : max();
+		const uint32_t raw = UINT32_MAX / magnitude; // 2^32 / x, off by less than one unit
+		return fromRaw((m_raw < 0) ? -(int32_t)(raw) : raw);
+	}
+
+	Fixed& operator+=(Fixed other){return *this = *this + other;}
+	Fixed& operator-=(Fixed other){return *this = *this - other;}
+	Fixed& operator*=(Fixed other){return *this = *this * other;}
+
+	bool operator==(Fixed other) const {return m_raw == other.m_raw;}
+	bool operator!=(Fixed other) const {return m_raw != other.m_raw;}
+	bool operator< (Fixed other) const {return m_raw <  other.m_raw;}
+	bool operator> (Fixed other) const {return m_raw >  other.m_raw;}
+	bool operator<=(Fixed other) const {return m_raw <= other.m_raw;}
+	bool operator>=(Fixed other) const {return m_raw >= other.m_raw;}
+
+private:
+
+	static int32_t saturate(int64_t raw)
+	{
+		if (raw > RAW_MAX) return RAW_MAX;
+		if (raw < RAW_MIN) return RAW_MIN;
+		return (int32_t)(raw);
+	}
+
+	static int32_t fromFloat(float value)
+	{
+		const float raw = value * RAW_ONE;
+		if (raw >= 2147483647.0f) return RAW_MAX;
+		if (raw <= -2147483648.0f) return RAW_MIN;
+		if (raw != raw) return 0; // NaN
+		return (int32_t)(raw >= 0 ? raw + 0.5f : raw - 0.5f);
+	}
+
+	int32_t m_raw;
+};
+
+#endif // __FIXED_H__
@@ -0,0 +1,59 @@
+#include <Arduino.h>
+
+#include "FlightRecorder.h"
+#include "serialutils.h"
+
+
+void FlightRecorder::arm(uint8_t triggers, int postTrigger)
+{
+	m_state = (triggers != 0) ? ARMED : DISARMED;
+	m_triggers = triggers;
+	m_trigger  = 0;
+	m_postTrigger = constrain(postTrigger, 0, FLIGHTRECORDER_MAX_SAMPLES);
+	m_head = 0;
+	m_numSamples = 0;
+	m_numPostTrigger = 0;
+}
+
+void FlightRecorder::trigger(Trigger trigger)
+{
+	if (m_state != ARMED || !(m_triggers & trigger))
+		return;
+
+	m_trigger = trigger;
+	m_state = (m_postTrigger > 0) ? TRIGGERED : FROZEN;
+}
+
+void FlightRecorder::record(const VelocityController& controller, const Odometry& odometry)
+{
+	if (m_state != ARMED && m_state != TRIGGERED)
+		return;
+
+	// Same encodings as Millimeters, RadiansPerSecond and Radians
+	const Position& position = odometry.getPosition();
+	Sample& sample = m_samples[m_head];
+	sample.linSetpoint = toFixed16(controller.getRampLinVelSetpoint(), 1);
+	sample.linInput    = toFixed16(odometry.getLinVel(),             1);
+	sample.linOutput   = toFixed16(controller.getLinVelOutput(),       1);
+	sample.angSetpoint = toFixed16(controller.getRampAngVelSetpoint(), 4096);
+	sample.angInput    = toFixed16(odometry.getAngVel(),             4096);
+	sample.angOutput   = toFixed16(controller.getAngVelOutput(),       4096);
+	sample.x           = toFixed16(position.x, 1);
+	sample.y           = toFixed16(position.y, 1);
+	sample.theta       = toFixed16(wrapAngle(position.theta), 8192);
+
+	m_head = (m_head + 1) % FLIGHTRECORDER_MAX_SAMPLES;
+	if (m_numSamples < FLIGHTRECORDER_MAX_SAMPLES)
+		m_numSamples++;
+
+	if (m_state == TRIGGERED && ++m_numPostTrigger >= m_postTrigger)
+		m_state = FROZEN;
+}
+
+const FlightRecorder::Sample& FlightRecorder::getSample(int index) const
+{
+	int oldest = m_head - m_numSamples;
+	if (oldest < 0)
+		oldest += FLIGHTRECORDER_MAX_SAMPLES;
+	return m_samples[(oldest + index) % FLIGHTRECORDER_MAX_SAMPLES];
+}
@@ -0,0 +1,79 @@
+#ifndef __FLIGHTRECORDER_H__
+#define __FLIGHTRECORDER_H__
+
+#include <Arduino.h>
+
+#include "NonCopyable.h"
+#include "VelocityController.h"
+#include "Odometry.h"
+
+#ifndef ENABLE_FLIGHTRECORDER
+#define ENABLE_FLIGHTRECORDER 0 // for debug purposes
+#endif
+
+#ifndef FLIGHTRECORDER_MAX_SAMPLES
+#define FLIGHTRECORDER_MAX_SAMPLES 64 // 18 bytes each
+#endif
+
+
+// Records the state of the velocity control loop at every run of the odometry into a ring buffer in
+// SRAM, so that it can be examined afterwards without streaming anything during the motion. The
+// odometry runs a few times faster than the control loop: the inputs and the position are fresh at
+// every sample, while the setpoints and outputs are the ones the control loop last applied.
+//
+// Once armed, it records continuously. When one of the armed triggers fires, it records the given
+// number of samples more and then freezes, so that the buffer holds what led to the trigger as
+// well as what followed it. It stays frozen until it is armed again.
+//
+// The samples use the compact encodings of serialutils.h: velocities in mm/s and Q3.12 rad/s, and
+// positions in mm and Q2.13 rad.
+
+class FlightRecorder : public NonCopyable
+{
+public:
+
+	enum State {DISARMED, ARMED, TRIGGERED, FROZEN};
+
+	enum Trigger
+	{
+		SPIN_SHUTDOWN = 0x01, // the velocity controller stopped the wheels because of an abnormal spin
+		GOAL_START    = 0x02, // a position control move started
+		HOST          = 0x04, // the host asked for it
+	};
+
+	struct Sample
+	{
+		int16_t linSetpoint, linInput, linOutput;
+		int16_t angSetpoint, angInput, angOutput;
+		int16_t x, y, theta;
+	};
+
+	FlightRecorder() : m_state(DISARMED), m_triggers(0), m_trigger(0), m_postTrigger(0), m_head(0), m_numSamples(0), m_numPostTrigger(0){}
+
+	void arm(uint8_t triggers, int postTrigger); // no triggers means disarm
+	void trigger(Trigger trigger);
+
+	void record(const VelocityController& controller, const Odometry& odometry);
+
+	State getState() const {return m_state;}
+	uint8_t getTrigger() const {return m_trigger;} // the one that fired, if any
+
+	// The samples are indexed from the oldest one
+	int getNumSamples() const {return m_numSamples;}
+	int getTriggerIndex() const {return m_numSamples - m_numPostTrigger;}
+	const Sample& getSample(int index) const;
+
+private:
+
+	State   m_state;
+	uint8_t m_triggers;
+	uint8_t m_trigger;
+	int     m_postTrigger;
+
+	Sample  m_samples[FLIGHTRECORDER_MAX_SAMPLES];
+	int     m_head; // where the next sample goes
+	int     m_numSamples;
+	int     m_numPostTrigger;
+};
+
+#endif // __FLIGHTRECORDER_H__
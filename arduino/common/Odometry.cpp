@@ -6,6 +6,15 @@
 
 #include <math.h>
 
+#if ODOMETRY_FASTMATH
+#include "fastmath.h"
+#define ODOMETRY_COS fastcos
+#define ODOMETRY_SIN fastsin
+#else
+#define ODOMETRY_COS cos
+#define ODOMETRY_SIN sin
+#endif
+
 
 void Odometry::process(float timestep)
 {
@@ -17,8 +26,10 @@ void Odometry::process(float timestep)
 	const float deltaAngPos = (dR - dL) / m_axleTrack;
 
 	const float avgTheta = m_pos.theta + deltaAngPos / 2;
-	m_pos.x     += deltaLinPos * cos(avgTheta) - deltaOrthLinPos * sin(avgTheta);
-	m_pos.y     += deltaLinPos * sin(avgTheta) + deltaOrthLinPos * cos(avgTheta);
+	const float cosTheta = ODOMETRY_COS(avgTheta);
+	const float sinTheta = ODOMETRY_SIN(avgTheta);
+	m_pos.x     += deltaLinPos * cosTheta - deltaOrthLinPos * sinTheta;
+	m_pos.y     += deltaLinPos * sinTheta + deltaOrthLinPos * cosTheta;
 	m_pos.theta += deltaAngPos;
 
 	m_linVel = deltaLinPos / timestep;
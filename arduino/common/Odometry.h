@@ -3,6 +3,9 @@
 
 #include "PeriodicProcess.h"
 
+#ifndef ODOMETRY_FASTMATH
+#define ODOMETRY_FASTMATH 0 // use the approximations of fastmath.h instead of the libm
+#endif
 
 struct Position
 {
@@ -6,44 +6,86 @@
 #include "mathutils.h"
 
 
-float PID::compute(float setpoint, float input, float timestep)
+static inline float reciprocal(float x){return 1 / x;}
+static inline Fixed reciprocal(Fixed x){return x.reciprocal();}
+
+template<typename T>
+static inline T saturate(T x, T min, T max)
+{
+	if (x < min) return min;
+	if (x > max) return max;
+	return x;
+}
+
+template<typename T>
+T PIDController<T>::compute(T setpoint, T input, T timestep)
 {
 	// Compute the error between the current state and the setpoint
-	float currentError = setpoint - input;
+	T currentError = setpoint - input;
 
 	// Compute the error integral
 	m_errorIntegral += currentError * timestep;
-	m_errorIntegral = saturate(m_errorIntegral, m_minOutput / m_Ki, m_maxOutput / m_Ki);
+	m_errorIntegral = saturate(m_errorIntegral, m_minIntegral, m_maxIntegral);
 
 	// Compute the error derivative
-	float errorDerivative = (currentError - m_previousError) / timestep;
+	if (timestep != m_timestep)
+	{
+		m_timestep = timestep;
+		m_invTimestep = reciprocal(timestep);
+	}
+	T errorDerivative = (currentError - m_previousError) * m_invTimestep;
 	m_previousError = currentError;
 
 	// Compute the PID controller's output
-	float output = m_Kp * currentError + m_Ki * m_errorIntegral - m_Kd * errorDerivative;
+	T output = m_Kp * currentError + m_Ki * m_errorIntegral - m_Kd * errorDerivative;
 	return saturate(output, m_minOutput, m_maxOutput);
 }
 
-void PID::reset()
+template<typename T>
+void PIDController<T>::reset()
 {
 	m_errorIntegral = 0;
 	m_previousError = 0;
 }
 
-void PID::load(int address)
+template<typename T>
+void PIDController<T>::updateIntegralLimits()
 {
-	EEPROM.get(address, m_Kp); address += sizeof(m_Kp);
-	EEPROM.get(address, m_Ki); address += sizeof(m_Ki);
-	EEPROM.get(address, m_Kd); address += sizeof(m_Kd);
-	EEPROM.get(address, m_minOutput); address += sizeof(m_minOutput);
-	EEPROM.get(address, m_maxOutput); address += sizeof(m_maxOutput);
+	// The integral term alone must not exceed the output limits
+	const float Ki = getKi();
+	m_minIntegral = (Ki != 0) ? getMinOutput() / Ki : -INFINITY;
+	m_maxIntegral = (Ki != 0) ? getMaxOutput() / Ki :  INFINITY;
+	if (Ki < 0)
+	{
+		T minIntegral = m_minIntegral;
+		m_minIntegral = m_maxIntegral;
+		m_maxIntegral = minIntegral;
+	}
 }
 
-void PID::save(int address) const
+template<typename T>
+void PIDController<T>::load(int address)
 {
-	EEPROM.put(address, m_Kp); address += sizeof(m_Kp);
-	EEPROM.put(address, m_Ki); address += sizeof(m_Ki);
-	EEPROM.put(address, m_Kd); address += sizeof(m_Kd);
-	EEPROM.put(address, m_minOutput); address += sizeof(m_minOutput);
-	EEPROM.put(address, m_maxOutput); address += sizeof(m_maxOutput);
+	float Kp, Ki, Kd, minOutput, maxOutput;
+	EEPROM.get(address, Kp); address += sizeof(Kp);
+	EEPROM.get(address, Ki); address += sizeof(Ki);
+	EEPROM.get(address, Kd); address += sizeof(Kd);
+	EEPROM.get(address, minOutput); address += sizeof(minOutput);
+	EEPROM.get(address, maxOutput); address += sizeof(maxOutput);
+	setTunings(Kp, Ki, Kd);
+	setOutputLimits(minOutput, maxOutput);
 }
+
+template<typename T>
+void PIDController<T>::save(int address) const
+{
+	const float Kp = getKp(), Ki = getKi(), Kd = getKd(), minOutput = getMinOutput(), maxOutput = getMaxOutput();
+	EEPROM.put(address, Kp); address += sizeof(Kp);
+	EEPROM.put(address, Ki); address += sizeof(Ki);
+	EEPROM.put(address, Kd); address += sizeof(Kd);
+	EEPROM.put(address, minOutput); address += sizeof(minOutput);
+	EEPROM.put(address, maxOutput); address += sizeof(maxOutput);
+}
+
+template class PIDController<float>;
+template class PIDController<Fixed>;
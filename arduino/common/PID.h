@@ -3,39 +3,62 @@
 
 #include <math.h>
 
+#include "Fixed.h"
 
-class PID
+#ifndef PID_FIXED_POINT
+#define PID_FIXED_POINT 0 // run the velocity loop in Q16.16 instead of float (see Fixed.h), not timed on the AVR yet
+#endif
+
+
+template<typename T>
+class PIDController
 {
 public:
 
-	PID() : m_Kp(1), m_Ki(0), m_Kd(0), m_minOutput(-INFINITY), m_maxOutput(INFINITY){}
+	typedef T Scalar;
+
+	PIDController() : m_timestep(0), m_invTimestep(0), m_Kp(1), m_Ki(0), m_Kd(0), m_minOutput(-INFINITY), m_maxOutput(INFINITY){updateIntegralLimits();}
 
-	float compute(float setpoint, float input, float timestep);
+	T compute(T setpoint, T input, T timestep);
 	
 	void reset();
 
-	void setTunings(float Kp, float Ki, float Kd){m_Kp = Kp, m_Ki = Ki, m_Kd = Kd;}
-	void setOutputLimits(float minOutput, float maxOutput){m_minOutput = minOutput; m_maxOutput = maxOutput;}
+	void setTunings(float Kp, float Ki, float Kd){m_Kp = Kp, m_Ki = Ki, m_Kd = Kd; updateIntegralLimits();}
+	void setOutputLimits(float minOutput, float maxOutput){m_minOutput = minOutput; m_maxOutput = maxOutput; updateIntegralLimits();}
 
-	float getKp() const {return m_Kp;}
-	float getKi() const {return m_Ki;}
-	float getKd() const {return m_Kd;}
-	float getMinOutput() const {return m_minOutput;}
-	float getMaxOutput() const {return m_maxOutput;}
+	float getKp() const {return float(m_Kp);}
+	float getKi() const {return float(m_Ki);}
+	float getKd() const {return float(m_Kd);}
+	float getMinOutput() const {return float(m_minOutput);}
+	float getMaxOutput() const {return float(m_maxOutput);}
 
+	// The EEPROM layout is the same whatever T is: five floats
 	void load(int address);
 	void save(int address) const;
 
 private:
 
-	float m_errorIntegral;
-	float m_previousError;
+	void updateIntegralLimits();
 
-	float m_Kp;
-	float m_Ki;
-	float m_Kd;
-	float m_minOutput;
-	float m_maxOutput;
+	T m_errorIntegral;
+	T m_previousError;
+
+	T m_timestep;
+	T m_invTimestep; // cached because divisions are the slowest operations of the AVR
+
+	T m_Kp;
+	T m_Ki;
+	T m_Kd;
+	T m_minOutput;
+	T m_maxOutput;
+	T m_minIntegral;
+	T m_maxIntegral;
 };
 
+#if PID_FIXED_POINT
+typedef PIDController<Fixed> PID;
+#else
+typedef PIDController<float> PID;
+#endif
+
 #endif // __PID_H__
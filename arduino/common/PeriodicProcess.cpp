@@ -1,11 +1,46 @@
 #include "PeriodicProcess.h"
+#include "Profiler.h"
 
 
+bool PeriodicProcess::checkDeadline(uint32_t now)
+{
+	if ((int32_t)(now - m_deadline) < 0)
+		return false;
+
+	// The deadlines are absolute so that late runs don't delay the next ones
+	const uint32_t lateness = now - m_deadline;
+	if (lateness < m_period || m_period == 0)
+	{
+		m_deadline += m_period;
+		return true;
+	}
+
+	const uint32_t missed = lateness / m_period; // on top of the current one
+	m_deadline += (missed + 1) * m_period;
+	switch (m_overrunPolicy)
+	{
+	case SKIP:
+		m_missedDeadlines += missed + 1;
+		return false;
+	case FIRE_ONCE:
+		m_missedDeadlines += missed;
+		startSchedule(now);
+		return true;
+	case CATCH_UP:
+	default:
+		m_missedDeadlines += missed;
+		return true;
+	}
+}
+
 bool PeriodicProcess::update()
 {
-	if (m_enabled && m_clock.getElapsedTime() > m_timestep)
+	if (m_enabled && checkDeadline(micros()))
 	{
-		float timestep = m_clock.restart();
+		Profiler::Probe probe(this);
+
+		// Only convert to seconds now that the process runs
+		float timestep = m_clock.restartMicros() * float(1e-6);
 		process(timestep);
 		return true;
 	}
@@ -17,7 +52,8 @@ void PeriodicProcess::enable()
 	if (!m_enabled)
 	{
 		m_enabled = true;
-		m_clock.restart();
+		m_clock.restartMicros();
+		startSchedule(micros());
 		onProcessEnabling();
 	}
 }
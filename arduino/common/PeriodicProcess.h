@@ -8,18 +8,34 @@ class PeriodicProcess
 {
 public:
 
+	// What to do when update() is called after one or more whole timesteps have passed since
+	// the last deadline. In every case process() is given the true time elapsed since its last run.
+	enum OverrunPolicy
+	{
+		SKIP,      // drop the missed deadlines and wait for the next one
+		CATCH_UP,  // run at once, then keep to the original schedule
+		FIRE_ONCE, // run at once, then restart the schedule from now
+	};
+
+	PeriodicProcess() : m_enabled(false), m_timestep(0), m_period(0), m_overrunPolicy(CATCH_UP), m_missedDeadlines(0){}
+
 	virtual ~PeriodicProcess(){}
 
 	void enable();
 	void disable();
 
-	void setTimestep(float timestep){m_timestep = timestep;} 
+	void setTimestep(float timestep){m_timestep = timestep; m_period = timestep * 1e6;}
+	void setOverrunPolicy(OverrunPolicy policy){m_overrunPolicy = policy;}
 
 	bool update();
 
 	bool isEnabled() const {return m_enabled;}
 
 	float getTimestep() const {return m_timestep;}
+	OverrunPolicy getOverrunPolicy() const {return m_overrunPolicy;}
+
+	unsigned long getMissedDeadlines() const {return m_missedDeadlines;}
+	void resetMissedDeadlines(){m_missedDeadlines = 0;}
 
 protected:
 
@@ -30,10 +46,20 @@ protected:
 
 private:
 
+	void startSchedule(uint32_t now){m_deadline = now + m_period;}
+	bool checkDeadline(uint32_t now);
+
 	bool  m_enabled;
 	float m_timestep;
 
+	uint32_t m_period;   // in us, so that update() compares integers only
+	uint32_t m_deadline; // in us, as returned by micros()
+	OverrunPolicy m_overrunPolicy;
+	unsigned long m_missedDeadlines;
+
 	Clock m_clock;
+
+	friend class Scheduler;
 };
 
 #endif // __PERIODICPROCESS_H__
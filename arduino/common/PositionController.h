@@ -11,9 +11,10 @@ class PositionController : public PeriodicProcess
 {
 public:
 
-	PositionController() : m_linVelKp(1), m_angVelKp(1), m_linVelMax(1000), m_angVelMax(2 * M_PI){}
+	PositionController() : m_linVelInput(0), m_angVelInput(0), m_linVelKp(1), m_angVelKp(1), m_linVelMax(1000), m_angVelMax(2 * M_PI){}
 
 	void setPosInput   (const Position& posInput)   {m_posInput    = posInput;}
+	void setVelInput   (float linVelInput, float angVelInput){m_linVelInput = linVelInput; m_angVelInput = angVelInput;}
 	void setPosSetpoint(const Position& posSetpoint){m_posSetpoint = posSetpoint;}
 
 	void setThetaSetpoint(float theta){m_posSetpoint.theta = theta;}
@@ -47,6 +48,8 @@ private:
 	// IO
 	Position m_posInput;
 	Position m_posSetpoint;
+	float m_linVelInput;
+	float m_angVelInput;
 
 	float m_linVelSetpoint;
 	float m_angVelSetpoint;
@@ -74,6 +77,8 @@ protected:
 
 	const Position& getPosInput()    const {return m_context->m_posInput;}
 	const Position& getPosSetpoint() const {return m_context->m_posSetpoint;}
+	float getLinVelInput() const {return m_context->m_linVelInput;}
+	float getAngVelInput() const {return m_context->m_angVelInput;}
 
 	void setVelSetpoints(float linVelSetpoint, float angVelSetpoint){m_context->m_linVelSetpoint = linVelSetpoint; m_context->m_angVelSetpoint = angVelSetpoint;}
 
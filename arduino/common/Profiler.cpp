@@ -0,0 +1,104 @@
+#include <Arduino.h>
+
+#include "Profiler.h"
+
+#if ENABLE_PROFILER
+
+// Global instance
+
+Profiler profiler;
+
+// Statistics
+
+void Profiler::Statistics::reset()
+{
+	count = 0;
+	min = UINT16_MAX;
+	max = 0;
+	total = 0;
+	for (int i = 0; i < PROFILER_HISTOGRAM_BINS; i++)
+		histogram[i] = 0;
+}
+
+void Profiler::Statistics::add(unsigned long value)
+{
+	const unsigned int clamped = (value < UINT16_MAX) ? value : UINT16_MAX;
+	count++;
+	if (clamped < min) min = clamped;
+	if (clamped > max) max = clamped;
+	total += value;
+
+	// Powers of two are enough to tell a few us from a few ms with shifts only
+	uint8_t bin = 0;
+	for (unsigned long x = value; x >= 16 && bin < PROFILER_HISTOGRAM_BINS - 1; x >>= 1)
+		bin++;
+	if (histogram[bin] < UINT16_MAX)
+		histogram[bin]++;
+}
+
+// Probe
+
+Profiler::Probe::Probe(const void* key) : m_section(profiler.find(key)), m_startTime(micros())
+{
+	if (m_section >= 0)
+		profiler.start(m_section, m_startTime);
+}
+
+Profiler::Probe::~Probe()
+{
+	if (m_section >= 0)
+		profiler.stop(m_section, micros(), m_startTime);
+}
+
+// Profiler
+
+bool Profiler::attach(const void* key, float period)
+{
+	if (m_numSections >= PROFILER_MAX_SECTIONS || find(key) >= 0)
+		return false;
+
+	Section& section = m_sections[m_numSections];
+	section.key = key;
+	section.period = period * 1e6;
+	section.duration.reset();
+	section.jitter.reset();
+	m_numSections++;
+	return true;
+}
+
+int8_t Profiler::find(const void* key) const
+{
+	for (uint8_t i = 0; i < m_numSections; i++)
+	{
+		if (m_sections[i].key == key)
+			return i;
+	}
+	return -1;
+}
+
+void Profiler::start(int8_t index, uint32_t now)
+{
+	Section& section = m_sections[index];
+	if (section.duration.count > 0)
+	{
+		const uint32_t interval = now - section.lastStart;
+		section.jitter.add((interval > section.period) ? interval - section.period : section.period - interval);
+	}
+	section.lastStart = now;
+}
+
+void Profiler::stop(int8_t index, uint32_t now, uint32_t startTime)
+{
+	m_sections[index].duration.add(now - startTime);
+}
+
+void Profiler::reset()
+{
+	for (uint8_t i = 0; i < m_numSections; i++)
+	{
+		m_sections[i].duration.reset();
+		m_sections[i].jitter.reset();
+	}
+}
+
+#endif // ENABLE_PROFILER
@@ -0,0 +1,97 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <Arduino.h>
+
+#include "NonCopyable.h"
+
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 0 // for debug purposes
+#endif
+
+#ifndef PROFILER_MAX_SECTIONS
+#define PROFILER_MAX_SECTIONS 4
+#endif
+
+#define PROFILER_HISTOGRAM_BINS 10 // <16us, then one per power of two up to >=4096us
+
+
+// Measures how long the profiled sections of code take and how regularly they start. A section
+// is identified by the address of the object it belongs to: PeriodicProcess::update, the
+// processes run by the Scheduler and SerialTalks::execute are already probed, so they only have
+// to be attached to be profiled.
+//
+// Durations are wall times in us, so they include the interrupts and the preemptions by the more
+// urgent scheduler tasks. Jitter is the difference between the interval from the previous start
+// and the expected period, or the interval itself if there is none.
+//
+// It is opt-in: with ENABLE_PROFILER set to 0 the probes compile to nothing.
+
+class Profiler : public NonCopyable
+{
+public:
+
+	struct Statistics
+	{
+		unsigned long count;
+		unsigned int  min;
+		unsigned int  max;
+		unsigned long total;
+		unsigned int  histogram[PROFILER_HISTOGRAM_BINS];
+
+		void reset();
+		void add(unsigned long value);
+		unsigned int getMean() const {return (count > 0) ? total / count : 0;}
+	};
+
+	class Probe : public NonCopyable
+	{
+	public:
+
+#if ENABLE_PROFILER
+		Probe(const void* key);
+		~Probe();
+
+	private:
+
+		int8_t   m_section;
+		uint32_t m_startTime;
+#else
+		Probe(const void* key){}
+#endif // ENABLE_PROFILER
+	};
+
+	Profiler() : m_numSections(0){}
+
+	bool attach(const void* key, float period = 0);
+
+	int getNumSections() const {return m_numSections;}
+	const Statistics& getDuration(int section) const {return m_sections[section].duration;}
+	const Statistics& getJitter  (int section) const {return m_sections[section].jitter;}
+	void reset();
+
+private:
+
+	struct Section
+	{
+		const void* key;
+		uint32_t period;    // us
+		uint32_t lastStart; // us, as returned by micros()
+
+		Statistics duration;
+		Statistics jitter;
+	};
+
+	int8_t find(const void* key) const;
+	void start(int8_t section, uint32_t now);
+	void stop (int8_t section, uint32_t now, uint32_t startTime);
+
+	Section m_sections[PROFILER_MAX_SECTIONS];
+	uint8_t m_numSections;
+};
+
+#if ENABLE_PROFILER
+extern Profiler profiler;
+#endif // ENABLE_PROFILER
+
+#endif // __PROFILER_H__
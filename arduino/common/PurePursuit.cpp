@@ -5,6 +5,21 @@
 #include "SerialTalks.h"
 #include "mathutils.h"
 
+#if PUREPURSUIT_FASTMATH
+#include "fastmath.h"
+#define PUREPURSUIT_SIN   fastsin
+#define PUREPURSUIT_COS   fastcos
+#define PUREPURSUIT_ATAN2 fastatan2
+#define PUREPURSUIT_SQRT  fastsqrt
+#define PUREPURSUIT_WRAP  fastwrap
+#else
+#define PUREPURSUIT_SIN   sin
+#define PUREPURSUIT_COS   cos
+#define PUREPURSUIT_ATAN2 atan2
+#define PUREPURSUIT_SQRT  sqrt
+#define PUREPURSUIT_WRAP(x) inrange(x, -M_PI, M_PI)
+#endif
+
 
 void PurePursuit::setDirection(Direction direction)
 {
@@ -14,78 +29,390 @@ void PurePursuit::setDirection(Direction direction)
 void PurePursuit::setFinalAngle(float finalAngle)
 {
 	m_finalAngle = finalAngle;
+	m_finalDirX = PUREPURSUIT_COS(finalAngle);
+	m_finalDirY = PUREPURSUIT_SIN(finalAngle);
 }
 
 bool PurePursuit::addWaypoint(const Waypoint& waypoint)
 {
-	if (m_numWaypoints < PUREPURSUIT_MAX_WAYPOINTS)
+	if (m_numWaypoints >= PUREPURSUIT_MAX_WAYPOINTS)
+		return false;
+
+	m_numReceived++;
+	if (m_numWaypoints == 0)
+		return addEdge(waypoint, 0, 0, 0, 0);
+
+	roundCorner(waypoint);
+	const Waypoint& last = getWaypoint(m_numWaypoints - 1);
+	const float edgedx = waypoint.x - last.x;
+	const float edgedy = waypoint.y - last.y;
+	const float edgeLength = sqrt(edgedx * edgedx + edgedy * edgedy);
+	const float dirx = (edgeLength > 0) ? edgedx / edgeLength : 0;
+	const float diry = (edgeLength > 0) ? edgedy / edgeLength : 0;
+	return addEdge(waypoint, dirx, diry, 0, edgeLength);
+}
+
+bool PurePursuit::addArc(const Waypoint& end, float radius)
+{
+	if (m_numWaypoints == 0 || radius == 0)
+		return addWaypoint(end);
+	if (m_numWaypoints >= PUREPURSUIT_MAX_WAYPOINTS)
+		return false;
+
+	// The arc leaves the chord by half its angle, on the outside of the turn. The radius can't be
+	// less than half the chord.
+	const Waypoint& start = getWaypoint(m_numWaypoints - 1);
+	const float dx = end.x - start.x;
+	const float dy = end.y - start.y;
+	const float chord = sqrt(dx * dx + dy * dy);
+	if (chord <= 0)
+		return addWaypoint(end);
+	const float halfChord = chord / 2;
+	const float absRadius = max(abs(radius), halfChord);
+	const float halfAngle = atan2(halfChord, sqrt(absRadius * absRadius - halfChord * halfChord));
+	const float c = cos(halfAngle);
+	const float s = (radius > 0) ? sin(halfAngle) : -sin(halfAngle);
+	m_numReceived++;
+	return addArcEdge(end, (dx * c + dy * s) / chord, (dy * c - dx * s) / chord);
+}
+
+bool PurePursuit::addBezier(const Waypoint& control1, const Waypoint& control2, const Waypoint& end)
+{
+	if (m_numWaypoints == 0)
+		return addWaypoint(end);
+	if (m_numWaypoints + PUREPURSUIT_BEZIER_ARCS > PUREPURSUIT_MAX_WAYPOINTS)
+		return false;
+
+	// The curve is split into arcs that go through evenly spaced points of it, each one tangent to
+	// the previous one, starting along the first control point. It takes several waypoints but the
+	// queries stay as cheap as for any other arc.
+	const Waypoint start = getWaypoint(m_numWaypoints - 1);
+	float dirx = control1.x - start.x;
+	float diry = control1.y - start.y;
+	if (dirx == 0 && diry == 0)
 	{
-		m_waypoints[m_numWaypoints++] = waypoint;
-		return true;
+		dirx = control2.x - start.x;
+		diry = control2.y - start.y;
+	}
+	if (dirx == 0 && diry == 0)
+	{
+		dirx = end.x - start.x;
+		diry = end.y - start.y;
+	}
+	const float norm = sqrt(dirx * dirx + diry * diry);
+	dirx = (norm > 0) ? dirx / norm : 1;
+	diry = (norm > 0) ? diry / norm : 0;
+
+	m_numReceived++;
+	for (int k = 1; k <= PUREPURSUIT_BEZIER_ARCS; k++)
+	{
+		const float t = (float)k / PUREPURSUIT_BEZIER_ARCS;
+		const float b0 = (1-t) * (1-t) * (1-t);
+		const float b1 = 3 * (1-t) * (1-t) * t;
+		const float b2 = 3 * (1-t) * t * t;
+		const float b3 = t * t * t;
+		const Waypoint point(b0 * start.x + b1 * control1.x + b2 * control2.x + b3 * end.x,
+		                     b0 * start.y + b1 * control1.y + b2 * control2.y + b3 * end.y);
+		addArcEdge((k < PUREPURSUIT_BEZIER_ARCS) ? point : end, dirx, diry);
+		getEdgeEndDir(m_numWaypoints - 2, dirx, diry);
+	}
+	return true;
+}
+
+bool PurePursuit::addArcEdge(const Waypoint& end, float dirx, float diry)
+{
+	// The arc that leaves the last waypoint along the given direction is set by its chord alone. A
+	// chord along that direction makes a straight line.
+	const Waypoint& start = getWaypoint(m_numWaypoints - 1);
+	const float dx = end.x - start.x;
+	const float dy = end.y - start.y;
+	const float chord2 = dx * dx + dy * dy;
+	const float cross = dirx * dy - diry * dx;
+	if (chord2 <= 0 || cross == 0)
+	{
+		const float chord = sqrt(chord2);
+		return addEdge(end, (chord > 0) ? dx / chord : dirx, (chord > 0) ? dy / chord : diry, 0, chord);
+	}
+	const float curvature = 2 * cross / chord2;
+	const float length = 2 * atan2(cross, dirx * dx + diry * dy) / curvature;
+	return addEdge(end, dirx, diry, curvature, length);
+}
+
+void PurePursuit::roundCorner(const Waypoint& waypoint)
+{
+	// The corner at the last waypoint is replaced by an arc tangent to both its edges, which takes
+	// one more waypoint. The arc may take the whole incoming edge but only half the outgoing one,
+	// so that the next corner gets the other half.
+	const int last = m_numWaypoints - 1;
+	if (m_cornerRadius <= 0 || last < 1 || m_numWaypoints + 2 > PUREPURSUIT_MAX_WAYPOINTS)
+		return;
+	if (getEdgeCurvature(last - 1) != 0 || m_goalIndex >= last)
+		return;
+
+	Waypoint& corner = m_waypoints[getSlot(last)];
+	const float inx = getEdgeDirX(last - 1);
+	const float iny = getEdgeDirY(last - 1);
+	const float dx = waypoint.x - corner.x;
+	const float dy = waypoint.y - corner.y;
+	const float outLength = sqrt(dx * dx + dy * dy);
+	if (outLength <= 0)
+		return;
+	const float outx = dx / outLength;
+	const float outy = dy / outLength;
+	const float cross = inx * outy - iny * outx;
+	const float dot   = inx * outx + iny * outy;
+	if (cross == 0)
+		return;
+
+	// The arc ends are at `dist` from the corner, that is the radius times the tangent of half the
+	// turn angle. Below a millimeter the corner is not worth a waypoint, and the arc would be lost
+	// in the rounding errors of its ends, as between two edges that are about aligned.
+	const float inLength = getEdgeLength(last - 1);
+	const float dist = min(m_cornerRadius * abs(cross) / (1 + dot), min(inLength, outLength / 2));
+	if (dist < 1)
+		return;
+
+	// The goal may be on the incoming edge but not beyond the arc start
+	if (m_goalIndex == last - 1)
+	{
+		const float s = m_goalParam * inLength;
+		if (s > inLength - dist)
+			return;
+		m_goalParam = (inLength - dist > 0) ? s / (inLength - dist) : 0;
+	}
+	const Waypoint arcEnd(corner.x + dist * outx, corner.y + dist * outy);
+	corner.x -= dist * inx;
+	corner.y -= dist * iny;
+	m_edges[getSlot(last - 1)].length -= dist;
+	m_pathLength -= dist;
+	addArcEdge(arcEnd, inx, iny);
+}
+
+bool PurePursuit::addEdge(const Waypoint& waypoint, float dirx, float diry, float curvature, float length)
+{
+	if (m_numWaypoints >= PUREPURSUIT_MAX_WAYPOINTS)
+		return false;
+
+	const int i = m_numWaypoints++;
+	const int slot = getSlot(i);
+	m_waypoints[slot] = waypoint;
+	m_profileUpToDate = false;
+	if (i > 0)
+	{
+		// Complete the edge that ends at the new waypoint
+		Edge& edge = m_edges[getSlot(i-1)];
+		edge.dirx = toFixed16(dirx, PUREPURSUIT_DIR_SCALE);
+		edge.diry = toFixed16(diry, PUREPURSUIT_DIR_SCALE);
+		edge.length = length;
+		edge.arc = (curvature != 0);
+		m_pathLength += length;
+		if (m_pathOpen)
+			setPathOpen(true);
+
+		// A goal on the one mm final edge is now at the start of a real one
+		if (m_goalIndex == i-1)
+			m_goalParam = 0;
+	}
+	return true;
+}
+
+void PurePursuit::setPathOpen(bool pathOpen)
+{
+	// Until its end is known, the path carries on in the direction of its last segment
+	m_pathOpen = pathOpen;
+	m_profileUpToDate = false;
+	if (m_pathOpen && m_numWaypoints >= 2)
+		getEdgeEndDir(m_numWaypoints - 2, m_finalDirX, m_finalDirY);
+}
+
+int PurePursuit::getNumFreeWaypoints() const
+{
+	const int numFree = PUREPURSUIT_MAX_WAYPOINTS - m_numWaypoints;
+	return (m_cornerRadius > 0) ? numFree / 2 : numFree;
+}
+
+float PurePursuit::getEndAngle() const
+{
+	if (m_numWaypoints < 2)
+		return 0;
+	float dirx, diry;
+	getEdgeEndDir(m_numWaypoints - 2, dirx, diry);
+	return atan2(diry, dirx);
+}
+
+float PurePursuit::getEdgeCurvature(int i) const
+{
+	// The arc that leaves a waypoint along the edge direction and goes through the next one, in
+	// mm^-1 and positive to the left
+	if (i >= m_numWaypoints - 1 || !m_edges[getSlot(i)].arc)
+		return 0;
+	const float dx = getWaypoint(i+1).x - getWaypoint(i).x;
+	const float dy = getWaypoint(i+1).y - getWaypoint(i).y;
+	return 2 * (getEdgeDirX(i) * dy - getEdgeDirY(i) * dx) / (dx * dx + dy * dy);
+}
+
+void PurePursuit::getEdgeEndDir(int i, float& dirx, float& diry) const
+{
+	// The tangent turns by the curvature times the length along an arc
+	dirx = getEdgeDirX(i);
+	diry = getEdgeDirY(i);
+	const float curvature = getEdgeCurvature(i);
+	if (curvature != 0)
+	{
+		const float angle = curvature * getEdgeLength(i);
+		const float c = cos(angle);
+		const float s = sin(angle);
+		const float x = dirx;
+		dirx = x * c - diry * s;
+		diry = x * s + diry * c;
 	}
-	return false;
+}
+
+void PurePursuit::getEdgePoint(int i, float param, Waypoint& point) const
+{
+	const Waypoint& start = getWaypoint(i);
+	const float curvature = getEdgeCurvature(i);
+	if (i == m_numWaypoints - 1)
+	{
+		point.x = start.x + param * m_finalDirX;
+		point.y = start.y + param * m_finalDirY;
+	}
+	else if (curvature == 0)
+	{
+		point.x = (1-param) * start.x + param * getWaypoint(i+1).x;
+		point.y = (1-param) * start.y + param * getWaypoint(i+1).y;
+	}
+	else
+	{
+		// Along the start tangent and towards the center of the arc
+		const float dirx = getEdgeDirX(i);
+		const float diry = getEdgeDirY(i);
+		const float angle = param * getEdgeLength(i) * curvature;
+		const float along  = PUREPURSUIT_SIN(angle) / curvature;
+		const float across = (1 - PUREPURSUIT_COS(angle)) / curvature;
+		point.x = start.x + along * dirx - across * diry;
+		point.y = start.y + along * diry + across * dirx;
+	}
+}
+
+void PurePursuit::getArcCenter(int i, float& centerx, float& centery) const
+{
+	const float curvature = getEdgeCurvature(i);
+	centerx = getWaypoint(i).x - getEdgeDirY(i) / curvature;
+	centery = getWaypoint(i).y + getEdgeDirX(i) / curvature;
+}
+
+float PurePursuit::getArcAngle(int i, float dx, float dy) const
+{
+	// The angle of a point seen from the arc center, from the start of the arc and in its direction
+	// of travel. It is wrapped around the middle of the arc so that the points before its start
+	// come out negative and the ones past its end come out greater than its angle.
+	const float dirx = getEdgeDirX(i);
+	const float diry = getEdgeDirY(i);
+	const float curvature = getEdgeCurvature(i);
+	const float outx = (curvature > 0) ?  diry : -diry;
+	const float outy = (curvature > 0) ? -dirx :  dirx;
+	const float arcAngle = getEdgeLength(i) * abs(curvature);
+	float angle = PUREPURSUIT_ATAN2(dirx * dx + diry * dy, outx * dx + outy * dy);
+	if (angle < arcAngle / 2 - M_PI)
+		angle += 2 * M_PI;
+	return angle;
 }
 
 void PurePursuit::reset()
 {
+	m_first = 0;
 	m_numWaypoints = 0;
+	m_numReceived = 0;
+	m_pathLength = 0;
 	m_direction = FORWARD;
+	m_pathOpen = false;
+	m_profileUpToDate = false;
 	m_goalIndex = 0;
 	m_goalParam = 0;
 	m_goalReached = false;
+	m_firstTurnCurvature = 0;
+	m_firstEntryCurvature = 0;
 }
 
-bool PurePursuit::checkLookAheadGoal(const float x, const float y)
+bool PurePursuit::checkLookAheadGoal(const float x, const float y, const float lookAhead)
 {
 	// The purpose of this function is to find the intersection point between a circle of radius
-	// `m_lookAhead` centered at the robot position and the path. As there may be several of them,
+	// `lookAhead` centered at the robot position and the path. As there may be several of them,
 	// we iterate through the path segments in the order of passing and stop as soon as we find
-	// one.
+	// one. The segments that can't hold it are rejected with a few products only. The goal doesn't
+	// go beyond the last waypoint of an open path, as the next ones are still unknown.
+	const float lookAheadBis = m_pathOpen ? 0 : m_lookAheadBis;
 	for (int i = m_goalIndex; i < m_numWaypoints; i++)
 	{
-		float dx = x - m_waypoints[i].x;
-		float dy = y - m_waypoints[i].y;
-		float edgedx, edgedy;
-		if (i < m_numWaypoints-1)
+		const float dx = x - getWaypoint(i).x;
+		const float dy = y - getWaypoint(i).y;
+		const float edgeDirX = getEdgeDirX(i);
+		const float edgeDirY = getEdgeDirY(i);
+		const float edgeLength = getEdgeLength(i);
+		const float curvature = getEdgeCurvature(i);
+		if (edgeLength <= 0) // Two identical waypoints in a row.
+			continue;
+
+		float s1, s2;
+		if (curvature == 0)
 		{
-			edgedx = m_waypoints[i+1].x - m_waypoints[i].x;
-			edgedy = m_waypoints[i+1].y - m_waypoints[i].y;	
+			// `h` is the distance between the robot and the current line (i.e. the current segment
+			// but without regard to its endpoints).
+			const float h = abs(edgeDirX * dy - edgeDirY * dx);
+			if (lookAhead < h) // There is no intersection between the current line and the circle.
+				continue;
+
+			// `s` is the position of the robot projection along the current segment, in mm. `s = 0`
+			// means that the robot projection is on its first endpoint and `s = edgeLength` means
+			// that it is on its second endpoint.
+			const float s = edgeDirX * dx + edgeDirY * dy;
+
+			// There is two intersection points between the circle and the line but we only consider
+			// the one ahead of the robot: if it is beyond the second endpoint (so it's not on the
+			// segment), then we go to the next. Both are within `lookAhead` of the projection, which
+			// rules most of the segments out before the square root.
+			if (s + lookAhead < 0 || (s > edgeLength && i < m_numWaypoints-1))
+				continue;
+			const float halfChord = PUREPURSUIT_SQRT(lookAhead * lookAhead - h * h);
+			s1 = s - halfChord;
+			s2 = s + halfChord;
 		}
 		else
 		{
-			edgedx = cos(m_finalAngle);
-			edgedy = sin(m_finalAngle);
+			// Same with the circle that holds the arc: the two circles only meet if the distance
+			// between their centers lies between the difference and the sum of their radii.
+			float centerx, centery;
+			getArcCenter(i, centerx, centery);
+			const float cx = x - centerx;
+			const float cy = y - centery;
+			const float radius = 1 / abs(curvature);
+			const float dist2 = cx * cx + cy * cy;
+			if (dist2 <= 0 || dist2 < (radius - lookAhead) * (radius - lookAhead) || dist2 > (radius + lookAhead) * (radius + lookAhead))
+				continue;
+
+			// The intersection points are on either side of the robot as seen from the center, at
+			// an angle given by the projection `a` of both of them on the line between the centers
+			const float dist = PUREPURSUIT_SQRT(dist2);
+			const float a = (dist2 + radius * radius - lookAhead * lookAhead) / (2 * dist);
+			const float halfAngle = PUREPURSUIT_ATAN2(PUREPURSUIT_SQRT(max(radius * radius - a * a, 0.0f)), a);
+			const float angle = getArcAngle(i, cx, cy);
+			s1 = (angle - halfAngle) * radius;
+			s2 = (angle + halfAngle) * radius;
 		}
-		float edgeLength = sqrt(edgedx * edgedx + edgedy * edgedy);
 
-		// `h` is the distance between the robot and the current line (i.e. the current segment but
-		// without regard to its endpoints).
-		float h = abs(edgedx * dy - edgedy * dx) / edgeLength;
-		if (m_lookAhead < h) // There is no intersection between the current line and the circle.
-			continue;
-		
-		// `t` is the relative position of the robot projection in the current segment.
-		// `t = 0` means that the robot projection is on its first endpoint and `t = 1` means
-		// that the robot projection is on its second endpoint.
-		float t = (edgedx * dx + edgedy * dy) / (edgeLength * edgeLength);
-
-		// There is two intersection points between the circle and the line but we only consider
-		// the one ahead of the robot: if it is beyond the second endpoint (so it's not on the
-		// segment), then we go to the next.
-		float t1 = t - sqrt(m_lookAhead * m_lookAhead - h * h) / edgeLength;
-		float t2 = t + sqrt(m_lookAhead * m_lookAhead - h * h) / edgeLength;
-		
 		// Skip if the intersection point is beyond the second endpoint (see above).
-		if (t2 < 0)
+		if (s2 < 0)
 			continue;
-		else if (t2 > 1 && i < m_numWaypoints-1)
+		else if (s2 > edgeLength && i < m_numWaypoints-1)
 			continue;
-		else if (t1 > 1 && i == m_numWaypoints-1)
+		else if (s1 > edgeLength && i == m_numWaypoints-1)
 			continue;
-		else if (t2 > 1 + m_lookAheadBis / edgeLength)
-			t2 = 1 + m_lookAheadBis / edgeLength;
+		else if (s2 > edgeLength + lookAheadBis)
+			s2 = edgeLength + lookAheadBis;
 
-		// Save the new goal.
+		// Save the new goal, as a relative position on the segment.
+		const float t2 = s2 / edgeLength;
 		if (i > m_goalIndex || t2 > m_goalParam)
 		{
 			m_goalIndex = i;
@@ -99,42 +426,56 @@ bool PurePursuit::checkLookAheadGoal(const float x, const float y)
 void PurePursuit::checkProjectionGoal(const float x, const float y)
 {
 	// The purpose of this function is to find the closest point between the path and the robot. To
-	// do so we iterate through all the segments, cmpute their distance to the robot and sort them.
-	float hmin = INFINITY;
+	// do so we iterate through all the segments, compute their distance to the robot and sort them.
+	// The distances are compared squared so that there is no square root to compute.
+	float h2min = INFINITY;
 	for (int i = m_goalIndex; i < m_numWaypoints-1; i++)
 	{
-		float dx = x - m_waypoints[i].x;
-		float dy = y - m_waypoints[i].y;
-		float edgedx = m_waypoints[i+1].x - m_waypoints[i].x;
-		float edgedy = m_waypoints[i+1].y - m_waypoints[i].y;
-		float edgeLength = sqrt(edgedx * edgedx + edgedy * edgedy);
-
-		// `t` and `h` have the same meaning than in the `checkLookAheadGoal` method.
-		float h, t = (edgedx * dx + edgedy * dy) / (edgeLength * edgeLength);
-		if (t > 1 && i+1 < m_numWaypoints-1)
+		const float dx = x - getWaypoint(i).x;
+		const float dy = y - getWaypoint(i).y;
+		const float edgeDirX = getEdgeDirX(i);
+		const float edgeDirY = getEdgeDirY(i);
+		const float edgeLength = getEdgeLength(i);
+		const float curvature = getEdgeCurvature(i);
+
+		// `s` and `h` have the same meaning than in the `checkLookAheadGoal` method. On an arc, the
+		// projection is along the radius.
+		float s, cx = 0, cy = 0;
+		if (curvature == 0)
+			s = edgeDirX * dx + edgeDirY * dy;
+		else
+		{
+			float centerx, centery;
+			getArcCenter(i, centerx, centery);
+			cx = x - centerx;
+			cy = y - centery;
+			s = getArcAngle(i, cx, cy) / abs(curvature);
+		}
+		if (s > edgeLength && i+1 < m_numWaypoints-1)
 			continue;
-		
-		if (t > 1) // The closest point of the segment is its second endpoint.
+
+		float h2;
+		if (s > edgeLength) // The closest point of the segment is its second endpoint.
 		{
-			float dx2 = x - m_waypoints[i+1].x;
-			float dy2 = y - m_waypoints[i+1].y;
-			h = sqrt(dx2 * dx2 + dy2 * dy2);
-			t = 1;
+			const float dx2 = x - getWaypoint(i+1).x;
+			const float dy2 = y - getWaypoint(i+1).y;
+			h2 = dx2 * dx2 + dy2 * dy2;
 		}
-		else if (t <= 0) // The closest point of the segment is its first endpoint.
+		else if (s <= 0) // The closest point of the segment is its first endpoint.
 		{
-			h = sqrt(dx * dx + dy * dy);
-			t = 0;
+			h2 = dx * dx + dy * dy;
 		}
 		else
 		{
-			h = abs(edgedx * dy - edgedy * dx) / edgeLength;
+			const float h = (curvature == 0) ? edgeDirX * dy - edgeDirY * dx : PUREPURSUIT_SQRT(cx * cx + cy * cy) - 1 / abs(curvature);
+			h2 = h * h;
 		}
 
 		// Save the new projection point if it is closer than the current one.
-		if (h < hmin)
+		if (h2 < h2min)
 		{
-			hmin = h;
+			h2min = h2;
+			const float t = (s > edgeLength) ? 1 : (s <= 0) ? 0 : s / edgeLength;
 			if (i > m_goalIndex || t > m_goalParam)
 			{
 				m_goalIndex = i;
@@ -144,31 +485,128 @@ void PurePursuit::checkProjectionGoal(const float x, const float y)
 	}
 }
 
-float PurePursuit::getDistAfterGoal()
+float PurePursuit::getAdaptiveLookAhead(float linVel) const
+{
+	// Aiming farther at high speed damps the oscillations around the path, while the robot still
+	// aims close once it slows down for a tight corner.
+	const float lookAhead = m_lookAheadGain * linVel;
+	return max(m_lookAhead, min(lookAhead, m_lookAheadMax));
+}
+
+float PurePursuit::getTurnVelMax(float curvature) const
+{
+	// The lateral acceleration is v^2 * curvature. The angular velocity is already dealt with by
+	// `computeVelSetpoints` at every step.
+	const float velMax = getLinVelMax();
+	if (velMax * velMax * curvature > m_maxLatAcc)
+		return PUREPURSUIT_SQRT(m_maxLatAcc / curvature);
+	return velMax;
+}
+
+float PurePursuit::getTurnCurvature(int i) const
+{
+	// The pure pursuit curvature is 2 sin(alpha) / lookAhead, with alpha the angle between the robot
+	// heading and its goal. At a corner it peaks when the robot reaches the waypoint with the goal
+	// on the next edge, so alpha is about the turn angle, up to a right angle. This is for a one mm
+	// look-ahead.
+	if (i == 0)
+		return m_firstTurnCurvature;
+	if (i >= m_numWaypoints - 1)
+		return 0;
+	float previousDirX, previousDirY;
+	getEdgeEndDir(i-1, previousDirX, previousDirY);
+	const float cross = abs(previousDirX * getEdgeDirY(i) - previousDirY * getEdgeDirX(i));
+	const float dot   = previousDirX * getEdgeDirX(i) + previousDirY * getEdgeDirY(i);
+	return 2 * ((dot >= 0) ? cross : 1);
+}
+
+float PurePursuit::getEntryCurvature(int i) const
+{
+	// Of the edge that ends at the waypoint
+	return (i > 0) ? abs(getEdgeCurvature(i-1)) : m_firstEntryCurvature;
+}
+
+float PurePursuit::getCornerVelMax(int index) const
+{
+	// The faster the robot goes through a corner, the longer its look-ahead and the wider its
+	// turn. Starting from the shortest look-ahead and widening the turn a couple of times never
+	// overestimates the velocity it can afford.
+	const float turnCurvature = getTurnCurvature(index);
+	float velMax = getTurnVelMax(turnCurvature / m_lookAhead);
+	for (int k = 0; k < 2 && m_lookAheadGain > 0; k++)
+		velMax = getTurnVelMax(turnCurvature / getAdaptiveLookAhead(velMax));
+
+	// The robot is still on the arc that ends at the waypoint when the goal passes it
+	return min(velMax, getTurnVelMax(getEntryCurvature(index)));
+}
+
+void PurePursuit::updateVelProfile()
+{
+	// Backward pass: the velocity at each waypoint is bounded by the corner it makes, by the arc
+	// that starts there and by the one the robot can slow down to before the next waypoint. An open
+	// path may stop at its last known waypoint, while the end of a closed one is left to the
+	// proportional control. There is no forward pass as the velocity controller already ramps the
+	// setpoints up. Only the waypoint after the goal is kept, as the goal never goes back.
+	const float linDec = m_velocityController->getMaxLinDec();
+	float velMax = m_pathOpen ? 0 : getLinVelMax();
+	for (int i = m_numWaypoints - 2; i > m_goalIndex; i--)
+	{
+		const float brakingVelMax = PUREPURSUIT_SQRT(velMax * velMax + 2 * linDec * getEdgeLength(i));
+		const float arcVelMax = getTurnVelMax(abs(getEdgeCurvature(i)));
+		velMax = min(min(getCornerVelMax(i), arcVelMax), brakingVelMax);
+	}
+	m_nextVelMax = velMax;
+	m_profileUpToDate = true;
+}
+
+float PurePursuit::getProfileVelMax(float lookAhead)
+{
+	if (m_maxLatAcc <= 0 || m_velocityController == 0)
+		return getLinVelMax();
+	if (!m_profileUpToDate)
+		updateVelProfile();
+
+	// The robot starts turning as soon as the goal passes a waypoint and is about through the
+	// corner once the goal is the look-ahead distance past it, so the profile follows the goal
+	// rather than the robot
+	const int i = m_goalIndex;
+	const float edgeLength = getEdgeLength(i);
+	float velMax = m_nextVelMax;
+	if (i < m_numWaypoints - 1)
+	{
+		const float linDec = m_velocityController->getMaxLinDec();
+		velMax = PUREPURSUIT_SQRT(m_nextVelMax * m_nextVelMax + 2 * linDec * (1 - m_goalParam) * edgeLength);
+	}
+	if (m_goalParam * edgeLength < lookAhead)
+		velMax = min(velMax, getCornerVelMax(i));
+	return min(velMax, getTurnVelMax(abs(getEdgeCurvature(i))));
+}
+
+float PurePursuit::getDistAfterGoal() const
 {
 	// This function computes the remaining distance between the current goal and the last
-	// waypoint. It basically does the sum of all the last segments lengths.
-	float dist = 0;
-	for (int i = m_goalIndex; i < m_numWaypoints; i++)
+	// waypoint, plus the one mm long last edge. The segments lengths are summed up as they come
+	// by `addEdge`, so only the ones behind the goal are left to take out.
+	float distAfterGoal = m_pathLength + 1 - m_goalParam * getEdgeLength(m_goalIndex);
+	for (int i = 0; i < m_goalIndex; i++)
+		distAfterGoal -= getEdgeLength(i);
+	return distAfterGoal;
+}
+
+void PurePursuit::retireWaypoints()
+{
+	// The goal never goes back, so the waypoints behind the segment it is on are of no use anymore
+	if (m_goalIndex > 0)
 	{
-		float edgedx, edgedy;
-		if (i < m_numWaypoints - 1)
-		{
-			edgedx = m_waypoints[i+1].x - m_waypoints[i].x;
-			edgedy = m_waypoints[i+1].y - m_waypoints[i].y;
-		}
-		else
-		{
-			edgedx = cos(m_finalAngle);
-			edgedy = sin(m_finalAngle);
-		}
-		float edgeLength = sqrt(edgedx * edgedx + edgedy * edgedy);
-		if (i == m_goalIndex)
-			dist += (1 - m_goalParam) * edgeLength;
-		else
-			dist += edgeLength;
+		m_firstTurnCurvature = getTurnCurvature(m_goalIndex);
+		m_firstEntryCurvature = getEntryCurvature(m_goalIndex);
+		for (int i = 0; i < m_goalIndex; i++)
+			m_pathLength -= getEdgeLength(i);
+		m_first = getSlot(m_goalIndex);
+		m_numWaypoints -= m_goalIndex;
+		m_goalIndex = 0;
+		m_profileUpToDate = false;
 	}
-	return dist;
 }
 
 void PurePursuit::computeVelSetpoints(float timestep)
@@ -184,55 +622,47 @@ void PurePursuit::computeVelSetpoints(float timestep)
 
 	// Compute the goal position on the path: `m_goalIndex` is the index of the segment it is
 	// located on and `m_goalParam` is its relative position on that segment.
-	if (!checkLookAheadGoal(x, y))
+	const float lookAhead = getAdaptiveLookAhead(abs(getLinVelInput()));
+	if (!checkLookAheadGoal(x, y, lookAhead))
 		checkProjectionGoal(x, y);
+	retireWaypoints();
 
 	// Compute the goal cartesian position.
-	int i = m_goalIndex;
-	float t = m_goalParam;
 	Waypoint goal;
-	if (i < m_numWaypoints - 1)
-	{
-		goal.x = (1-t) * m_waypoints[i].x + t * m_waypoints[i+1].x;
-		goal.y = (1-t) * m_waypoints[i].y + t * m_waypoints[i+1].y;
-	}
-	else
-	{
-		goal.x = m_waypoints[i].x + t * cos(m_finalAngle);
-		goal.y = m_waypoints[i].y + t * sin(m_finalAngle);
-	}
+	getEdgePoint(m_goalIndex, m_goalParam, goal);
 
 	// Compute the norm and the argument of the vector going from the robot to its goal.
-	float chord = sqrt((goal.x - x) * (goal.x - x) + (goal.y - y) * (goal.y - y));
-	float delta = atan2(goal.y - y, goal.x - x) - theta + M_PI / 2 * (1 - m_direction);
+	float chord = PUREPURSUIT_SQRT((goal.x - x) * (goal.x - x) + (goal.y - y) * (goal.y - y));
+	float delta = PUREPURSUIT_ATAN2(goal.y - y, goal.x - x) - theta + M_PI / 2 * (1 - m_direction);
 
 	// The minimum curvature that the robot must follow is `2 * sin(delta) / chord`. So we deduce
 	// from this and the maximum linear velocity allowed the maximum angular velocity setpoint. If
 	// it exceeds the maximum angular velocity allowed, then we do the opposite: we use the maximum
 	// angular velocity allowed to compute the maximum linear velocity setpoint.
-	float newLinVelMax = linVelMax;
+	float newLinVelMax = min(linVelMax, getProfileVelMax(lookAhead));
 	float newAngVelMax = angVelMax;
-	if (newAngVelMax * chord >= newLinVelMax * abs(2 * sin(delta)))
-		newAngVelMax = newLinVelMax * abs(2 * sin(delta)) / chord;
+	if (newAngVelMax * chord >= newLinVelMax * abs(2 * PUREPURSUIT_SIN(delta)))
+		newAngVelMax = newLinVelMax * abs(2 * PUREPURSUIT_SIN(delta)) / chord;
 	else
-		newLinVelMax = newAngVelMax * chord / abs(2 * sin(delta));
+		newLinVelMax = newAngVelMax * chord / abs(2 * PUREPURSUIT_SIN(delta));
 	
 	// Then we do a simple proportional control for both linear and angular velocities.
-	float linPosSetpoint = (chord + getDistAfterGoal()) * m_direction;
+	const float distAfterGoal = getDistAfterGoal();
+	float linPosSetpoint = (chord + distAfterGoal) * m_direction;
 	float linVelSetpoint = saturate(linVelKp * linPosSetpoint, -newLinVelMax, newLinVelMax);
 
-	float angPosSetpoint = inrange(delta, -M_PI, M_PI);
+	float angPosSetpoint = PUREPURSUIT_WRAP(delta);
 	float angVelSetpoint = saturate(angVelKp * angPosSetpoint, -newAngVelMax, newAngVelMax);
 
 	// When traveling on the path, we slow down the robot if its orientation is farther than it
 	// should. The following is an empiric but continuous formula.
-	if (cos(delta) > 0)
-		linVelSetpoint *= (1 + cos(2 * delta)) / 2;
+	if (PUREPURSUIT_COS(delta) > 0)
+		linVelSetpoint *= (1 + PUREPURSUIT_COS(2 * delta)) / 2;
 	else
 		linVelSetpoint *= 0;
 	
 	// This could be computed elsewhere but here is convenient. 
-	m_goalReached = abs(chord + getDistAfterGoal()) < getLinPosThreshold();
+	m_goalReached = !m_pathOpen && abs(chord + distAfterGoal) < getLinPosThreshold();
 
 	setVelSetpoints(linVelSetpoint, angVelSetpoint);
 }
@@ -246,10 +676,24 @@ void PurePursuit::load(int address)
 {
 	EEPROM.get(address, m_lookAhead);    address += sizeof(m_lookAhead);
 	EEPROM.get(address, m_lookAheadBis); address += sizeof(m_lookAheadBis);
+	EEPROM.get(address, m_lookAheadMax);  address += sizeof(m_lookAheadMax);
+	EEPROM.get(address, m_lookAheadGain); address += sizeof(m_lookAheadGain);
+	EEPROM.get(address, m_maxLatAcc);     address += sizeof(m_maxLatAcc);
+	EEPROM.get(address, m_cornerRadius);  address += sizeof(m_cornerRadius);
+
+	// Erased EEPROM reads as NaN on the boards set up before these existed
+	if (isnan(m_lookAheadMax))  m_lookAheadMax  = 0;
+	if (isnan(m_lookAheadGain)) m_lookAheadGain = 0;
+	if (isnan(m_maxLatAcc))     m_maxLatAcc     = 0;
+	if (isnan(m_cornerRadius))  m_cornerRadius  = 0;
 }
 
 void PurePursuit::save(int address) const
 {
 	EEPROM.put(address, m_lookAhead);    address += sizeof(m_lookAhead);
 	EEPROM.put(address, m_lookAheadBis); address += sizeof(m_lookAheadBis);
+	EEPROM.put(address, m_lookAheadMax);  address += sizeof(m_lookAheadMax);
+	EEPROM.put(address, m_lookAheadGain); address += sizeof(m_lookAheadGain);
+	EEPROM.put(address, m_maxLatAcc);     address += sizeof(m_maxLatAcc);
+	EEPROM.put(address, m_cornerRadius);  address += sizeof(m_cornerRadius);
 }
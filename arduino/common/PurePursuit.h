@@ -2,6 +2,7 @@
 #define __PUREPURSUIT_H__
 
 #include "PositionController.h"
+#include "VelocityController.h"
 #include "Odometry.h"
 
 #include <math.h>
@@ -10,6 +11,16 @@
 #define PUREPURSUIT_MAX_WAYPOINTS 16
 #endif
 
+#ifndef PUREPURSUIT_BEZIER_ARCS
+#define PUREPURSUIT_BEZIER_ARCS 4 // waypoints taken by each Bezier curve
+#endif
+
+#define PUREPURSUIT_DIR_SCALE 16384 // the edges directions are stored in Q14
+
+#ifndef PUREPURSUIT_FASTMATH
+#define PUREPURSUIT_FASTMATH 0 // use the approximations of fastmath.h instead of the libm
+#endif
+
 
 class PurePursuit : public AbstractMoveStrategy
 {
@@ -26,24 +37,59 @@ public:
 
 	enum Direction {FORWARD=1, BACKWARD=-1};
 
-	PurePursuit() : m_numWaypoints(0), m_direction(FORWARD){}
+	PurePursuit() : m_first(0), m_numWaypoints(0), m_numReceived(0), m_direction(FORWARD), m_finalAngle(0), m_pathOpen(false), m_lowWatermark(0), m_pathLength(0), m_finalDirX(1), m_finalDirY(0), m_firstTurnCurvature(0), m_firstEntryCurvature(0), m_goalIndex(0), m_goalParam(0), m_goalReached(false), m_profileUpToDate(false), m_nextVelMax(0), m_lookAheadMax(0), m_lookAheadGain(0), m_maxLatAcc(0), m_cornerRadius(0), m_velocityController(0){}
 
 	void setDirection(Direction direction);
 	void setFinalAngle(float finalAngle);
+
+	// The path goes from one waypoint to the next along a straight line, an arc of the given
+	// radius (positive to turn left, at most a half circle) or a cubic Bezier curve. The corners
+	// between straight lines are rounded with `cornerRadius` if it isn't zero.
 	bool addWaypoint(const Waypoint& waypoint);
+	bool addArc(const Waypoint& end, float radius);
+	bool addBezier(const Waypoint& control1, const Waypoint& control2, const Waypoint& end);
+	void setCornerRadius(float cornerRadius){m_cornerRadius = cornerRadius;}
 
 	void reset();
 
+	// An open path is still being streamed: more waypoints may come while the robot drives, so it
+	// never ends at the last one it knows. The waypoints behind the goal are dropped as it goes, so
+	// that the host can keep appending new ones in their place.
+	void setPathOpen(bool pathOpen);
+	void setLowWatermark(int lowWatermark){m_lowWatermark = lowWatermark;}
+
+	// The look-ahead grows with the linear velocity, as `lookAheadGain` times it, from `lookAhead`
+	// up to `lookAheadMax`. A zero gain keeps it constant.
 	void setLookAhead   (float lookAhead)   {m_lookAhead    = lookAhead;}
 	void setLookAheadBis(float lookAheadBis){m_lookAheadBis = lookAheadBis;}
+	void setLookAheadMax (float lookAheadMax) {m_lookAheadMax  = lookAheadMax;}
+	void setLookAheadGain(float lookAheadGain){m_lookAheadGain = lookAheadGain;}
+
+	// The linear velocity is planned ahead so that the robot slows down before the corners, with
+	// the deceleration of the velocity controller, and goes through them with no more than the
+	// given lateral acceleration. A zero lateral acceleration disables it.
+	void setMaxLatAcc(float maxLatAcc){m_maxLatAcc = maxLatAcc;}
+	void setVelocityController(const VelocityController& velocityController){m_velocityController = &velocityController;}
 
 	Direction getDirection() const {return m_direction;}
 	float getFinalAngle() const {return m_finalAngle;}
-	const Waypoint& getWaypoint(int index) const {return m_waypoints[index];}
+	const Waypoint& getWaypoint(int index) const {return m_waypoints[getSlot(index)];}
 	int getNumWaypoints() const {return m_numWaypoints;}
+	float getEndAngle() const; // heading along the path at its last waypoint
+
+	bool isPathOpen() const {return m_pathOpen;}
+	int getLowWatermark() const {return m_lowWatermark;}
+	int getNumFreeWaypoints() const; // for straight lines, which may take two slots with rounded corners
+	int getNumWaypointsAhead() const {return m_numWaypoints - 1 - m_goalIndex;}
+	unsigned int getNumReceivedWaypoints() const {return m_numReceived;} // since the last reset, wraps around
+	bool isBelowLowWatermark() const {return m_pathOpen && getNumWaypointsAhead() <= m_lowWatermark;}
 
 	float getLookAhead()    const {return m_lookAhead;}
 	float getLookAheadBis() const {return m_lookAheadBis;}
+	float getLookAheadMax()  const {return m_lookAheadMax;}
+	float getLookAheadGain() const {return m_lookAheadGain;}
+	float getMaxLatAcc() const {return m_maxLatAcc;}
+	float getCornerRadius() const {return m_cornerRadius;}
 
 	void load(int address);
 	void save(int address) const;
@@ -53,24 +99,78 @@ protected:
 	virtual void computeVelSetpoints(float timestep);
 	virtual bool getPositionReached();
 
-	bool checkLookAheadGoal(const float x, const float y);
+	bool addEdge(const Waypoint& waypoint, float dirx, float diry, float curvature, float length);
+	bool addArcEdge(const Waypoint& end, float dirx, float diry);
+	void roundCorner(const Waypoint& waypoint);
+	void getEdgeEndDir(int i, float& dirx, float& diry) const;
+	void getEdgePoint(int i, float param, Waypoint& point) const;
+	void getArcCenter(int i, float& centerx, float& centery) const;
+	float getArcAngle(int i, float dx, float dy) const;
+
+	float getAdaptiveLookAhead(float linVel) const;
+	float getTurnVelMax(float curvature) const;
+	float getTurnCurvature(int i) const;
+	float getEntryCurvature(int i) const;
+	float getCornerVelMax(int index) const;
+	void updateVelProfile();
+	float getProfileVelMax(float lookAhead);
+	bool checkLookAheadGoal(const float x, const float y, const float lookAhead);
 	void checkProjectionGoal(const float x, const float y);
-	float getDistAfterGoal();
+	float getDistAfterGoal() const;
+	void retireWaypoints();
+
+	// The waypoints are stored in a ring buffer, from the oldest one in the `m_first` slot
+	int getSlot(int index) const
+	{
+		const int slot = m_first + index;
+		return (slot < PUREPURSUIT_MAX_WAYPOINTS) ? slot : slot - PUREPURSUIT_MAX_WAYPOINTS;
+	}
+
+	// The edge that starts at a waypoint goes to the next one, or follows the final angle for one
+	// mm for the last waypoint
+	float getEdgeDirX  (int i) const {return (i < m_numWaypoints - 1) ? m_edges[getSlot(i)].dirx / (float)PUREPURSUIT_DIR_SCALE : m_finalDirX;}
+	float getEdgeDirY  (int i) const {return (i < m_numWaypoints - 1) ? m_edges[getSlot(i)].diry / (float)PUREPURSUIT_DIR_SCALE : m_finalDirY;}
+	float getEdgeLength(int i) const {return (i < m_numWaypoints - 1) ? m_edges[getSlot(i)].length : 1;}
+	float getEdgeCurvature(int i) const;
 
 	// Trajectory specifications
 	Waypoint m_waypoints[PUREPURSUIT_MAX_WAYPOINTS];
+	int m_first;
 	int m_numWaypoints;
+	unsigned int m_numReceived;
 	Direction m_direction;
 	float m_finalAngle;
+	bool m_pathOpen;
+	int m_lowWatermark;
+
+	// Edges geometry, computed once by addEdge and setFinalAngle so that the ticks need no
+	// square root but for the look-ahead intersection. They share the waypoints slots.
+	struct Edge
+	{
+		int16_t dirx, diry; // unit vector, tangent to the edge at its start
+		float length;       // in mm
+		bool arc;           // the curvature follows from the start tangent and the chord
+	};
+	Edge m_edges[PUREPURSUIT_MAX_WAYPOINTS];
+	float m_pathLength; // in mm, from the first waypoint to the last one
+	float m_finalDirX, m_finalDirY;
+	float m_firstTurnCurvature, m_firstEntryCurvature; // of the first waypoint, whose edge in is retired
 
 	// Computation variables
 	int m_goalIndex;
 	float m_goalParam;
 	bool m_goalReached;
+	bool m_profileUpToDate;
+	float m_nextVelMax; // in mm/s, as the goal passes the waypoint after its own (or the last one)
 
 	// Path following tunings
 	float m_lookAhead;
 	float m_lookAheadBis;
+	float m_lookAheadMax;
+	float m_lookAheadGain; // s
+	float m_maxLatAcc;
+	float m_cornerRadius;
+	const VelocityController* m_velocityController;
 };
 
 #endif // __PUREPURSUIT_H__
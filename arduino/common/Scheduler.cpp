@@ -0,0 +1,213 @@
+#include <Arduino.h>
+
+#include "Scheduler.h"
+#include "Profiler.h"
+
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#endif
+
+// Global instance, driven by the Timer1 interrupt
+
+Scheduler scheduler;
+
+#ifdef __AVR__
+ISR(TIMER1_COMPA_vect)
+{
+	scheduler.tick();
+}
+#endif
+
+// Lock
+
+#ifdef __AVR__
+Scheduler::Lock::Lock() : m_timsk1(TIMSK1)
+{
+	TIMSK1 = m_timsk1 & ~_BV(OCIE1A);
+}
+
+Scheduler::Lock::~Lock()
+{
+	TIMSK1 = m_timsk1;
+}
+#else
+Scheduler::Lock::Lock() : m_timsk1(0){}
+
+Scheduler::Lock::~Lock(){}
+#endif // __AVR__
+
+// Scheduler
+
+bool Scheduler::attach(PeriodicProcess& process, Context context, void (*inputs)(), void (*outputs)())
+{
+	if (m_numTasks >= SCHEDULER_MAX_TASKS)
+		return false;
+
+	Task& task = m_tasks[m_numTasks];
+	task.process = &process;
+	task.context = context;
+	task.inputs  = inputs;
+	task.outputs = outputs;
+	task.pending = false;
+	task.lastJitter = 0;
+	task.maxJitter  = 0;
+	task.overruns   = 0;
+	m_numTasks++;
+	return true;
+}
+
+void Scheduler::begin()
+{
+	// Start the schedules along with the timer so that the deadlines fall on its ticks
+	const uint32_t now = micros();
+	for (uint8_t i = 0; i < m_numTasks; i++)
+	{
+		m_tasks[i].process->startSchedule(now);
+		m_tasks[i].pending = false;
+	}
+
+#ifdef __AVR__
+	// Timer1 in CTC mode, counting at 16 MHz / 64 = 250 kHz
+	TCCR1A = 0;
+	TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+	OCR1A  = F_CPU / 64 / (1000000 / SCHEDULER_TICK) - 1;
+	TCNT1  = 0;
+	TIFR1  = _BV(OCF1A);
+	TIMSK1 |= _BV(OCIE1A);
+#endif
+}
+
+void Scheduler::end()
+{
+#ifdef __AVR__
+	TIMSK1 &= ~_BV(OCIE1A);
+	TCCR1B = 0;
+#endif
+}
+
+void Scheduler::release(Task& task, uint32_t now)
+{
+	PeriodicProcess& process = *task.process;
+	if (!process.isEnabled() || !process.checkDeadline(now))
+		return;
+
+	if (task.pending)
+		task.overruns++;
+	else
+	{
+		task.release = now;
+		task.pending = true;
+	}
+}
+
+void Scheduler::execute(Task& task, uint32_t releaseTime)
+{
+	const uint32_t jitter = micros() - releaseTime;
+	task.lastJitter = jitter;
+	if (jitter > task.maxJitter)
+		task.maxJitter = jitter;
+
+	PeriodicProcess& process = *task.process;
+	if (process.isEnabled())
+	{
+		Profiler::Probe probe(&process);
+		if (task.inputs != 0)
+		{
+			Lock lock;
+			task.inputs();
+		}
+		process.process(process.m_clock.restartMicros() * float(1e-6));
+		if (task.outputs != 0)
+		{
+			Lock lock;
+			task.outputs();
+		}
+	}
+}
+
+void Scheduler::tick()
+{
+	const uint32_t now = micros();
+	for (uint8_t i = 0; i < m_numTasks; i++)
+		release(m_tasks[i], now);
+
+	// Run the due INTERRUPT tasks that are more urgent than the one this tick preempted, if any
+	const uint8_t preempted = m_running;
+	for (uint8_t i = 0; i < m_numTasks && i < preempted; i++)
+	{
+		Task& task = m_tasks[i];
+		if (task.context == INTERRUPT && task.pending)
+		{
+			task.pending = false;
+			m_running = i;
+#ifdef __AVR__
+			sei();
+			execute(task, task.release);
+			cli();
+#else
+			execute(task, task.release);
+#endif
+		}
+	}
+	m_running = preempted;
+}
+
+void Scheduler::run()
+{
+#ifndef __AVR__
+	tick(); // There are no timer interrupts on the host
+#endif
+
+	for (uint8_t i = 0; i < m_numTasks; i++)
+	{
+		Task& task = m_tasks[i];
+		if (task.context != LOOP)
+			continue;
+
+		uint32_t releaseTime;
+		{
+			Lock lock;
+			if (!task.pending)
+				continue;
+			releaseTime = task.release;
+			task.pending = false;
+		}
+		execute(task, releaseTime);
+	}
+}
+
+unsigned long Scheduler::getLastJitter(int task) const
+{
+	Lock lock;
+	return m_tasks[task].lastJitter;
+}
+
+unsigned long Scheduler::getMaxJitter(int task) const
+{
+	Lock lock;
+	return m_tasks[task].maxJitter;
+}
+
+unsigned int Scheduler::getOverruns(int task) const
+{
+	Lock lock;
+	return m_tasks[task].overruns;
+}
+
+unsigned long Scheduler::getMissedDeadlines(int task) const
+{
+	Lock lock;
+	return m_tasks[task].process->getMissedDeadlines();
+}
+
+void Scheduler::resetStatistics()
+{
+	Lock lock;
+	for (uint8_t i = 0; i < m_numTasks; i++)
+	{
+		m_tasks[i].lastJitter = 0;
+		m_tasks[i].maxJitter  = 0;
+		m_tasks[i].overruns   = 0;
+		m_tasks[i].process->resetMissedDeadlines();
+	}
+}
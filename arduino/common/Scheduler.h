@@ -0,0 +1,96 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <Arduino.h>
+
+#include "PeriodicProcess.h"
+#include "NonCopyable.h"
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 6
+#endif
+
+#define SCHEDULER_TICK 1000 // us, period of the Timer1 interrupt
+
+
+// Runs periodic processes at fixed rates from the Timer1 interrupt instead of polling them in
+// loop(), so that their timesteps don't depend on what the main loop is doing.
+//
+// The tasks are prioritized in the order they are attached in, the most urgent first. INTERRUPT
+// tasks run in the timer interrupt with the other interrupts enabled, and preempt the less urgent
+// ones. LOOP tasks are only flagged there and run by run() from the main loop: they are the ones
+// that use Serial, the EEPROM or anything else that is not safe in an interrupt.
+//
+// The main loop must hold a Scheduler::Lock whenever it accesses the state of an INTERRUPT task.
+// The tasks exchange their data in their inputs and outputs hooks, which run under the lock just
+// before and just after process().
+//
+// On the host there are no timer interrupts: run() polls all the tasks.
+
+class Scheduler : public NonCopyable
+{
+public:
+
+	enum Context {INTERRUPT, LOOP};
+
+	class Lock : public NonCopyable
+	{
+	public:
+
+		Lock();
+		~Lock();
+
+	private:
+
+		uint8_t m_timsk1;
+	};
+
+	Scheduler() : m_numTasks(0), m_running(SCHEDULER_MAX_TASKS){}
+
+	bool attach(PeriodicProcess& process, Context context, void (*inputs)() = 0, void (*outputs)() = 0);
+
+	void begin();
+	void end();
+
+	void run();
+
+	// Jitter is the delay between the tick a task is due in and the instant it starts, in us.
+	// Overruns are the deadlines dropped because the task was still running or waiting to. The
+	// deadlines themselves are tracked by the processes (see PeriodicProcess::OverrunPolicy).
+	int getNumTasks() const {return m_numTasks;}
+	unsigned long getLastJitter(int task) const;
+	unsigned long getMaxJitter (int task) const;
+	unsigned int  getOverruns  (int task) const;
+	unsigned long getMissedDeadlines(int task) const;
+	void resetStatistics();
+
+	void tick(); // called by the Timer1 interrupt
+
+private:
+
+	struct Task
+	{
+		PeriodicProcess* process;
+		Context context;
+		void (*inputs)();
+		void (*outputs)();
+
+		uint32_t release; // us, start of the tick the task became due in
+		volatile bool pending;
+
+		unsigned long lastJitter;
+		unsigned long maxJitter;
+		unsigned int  overruns;
+	};
+
+	void release(Task& task, uint32_t now);
+	void execute(Task& task, uint32_t releaseTime);
+
+	Task m_tasks[SCHEDULER_MAX_TASKS];
+	uint8_t m_numTasks;
+	volatile uint8_t m_running; // index of the running INTERRUPT task, or SCHEDULER_MAX_TASKS
+};
+
+extern Scheduler scheduler;
+
+#endif // __SCHEDULER_H__
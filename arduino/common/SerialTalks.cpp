@@ -1,7 +1,14 @@
 #include "SerialTalks.h"
 #include "Clock.h"
+#include "Profiler.h"
 #include <EEPROM.h>
 
+#define SERIALTALKS_UNREPLAYABLE_RESPONSE 0xFF
+
+#ifndef pgm_read_ptr
+#define pgm_read_ptr(address) ((void*)(pgm_read_word(address)))
+#endif
+
 
 // Global instance
 
@@ -29,6 +36,55 @@ void SerialTalks::SETUUID(SerialTalks& inst, Deserializer& input, Serializer& ou
 	talks.setUUID(uuid);
 }
 
+void SerialTalks::SUBSCRIBE(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	// The pushed frames are sent back with the retcode chosen by the host, not with the one of
+	// this request. The instruction to execute periodically must not expect any argument.
+	byte          opcode  = input.read<byte>();
+	unsigned int  period  = input.read<unsigned int>();
+	long          retcode = input.read<long>();
+	for (int i = 0; i < SERIALTALKS_MAX_SUBSCRIPTIONS; i++)
+	{
+		Subscription& subscription = talks.m_subscriptions[i];
+		if (subscription.period == 0 && period > 0 && talks.getInstruction(opcode) != 0)
+		{
+			subscription.opcode   = opcode;
+			subscription.period   = period;
+			subscription.retcode  = retcode;
+			subscription.lastTime = millis();
+			subscription.size     = 0;
+			output << true;
+			return;
+		}
+	}
+	output << false;
+}
+
+void SerialTalks::UNSUBSCRIBE(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	long retcode = input.read<long>();
+	for (int i = 0; i < SERIALTALKS_MAX_SUBSCRIPTIONS; i++)
+	{
+		if (talks.m_subscriptions[i].retcode == retcode)
+			talks.m_subscriptions[i].period = 0;
+	}
+}
+
+void SerialTalks::SETBAUDRATE(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	// The new baudrate is applied only after the acknowledgement has been sent with the current
+	// one. Then the host has SERIALTALKS_BAUDRATE_TIMEOUT ms to send an instruction with the new
+	// baudrate, otherwise the board falls back to the default one.
+	unsigned long baudrate = input.read<unsigned long>();
+	if (talks.m_serial != 0 && baudrate > 0)
+	{
+		talks.m_pendingBaudrate = baudrate;
+		output << true;
+	}
+	else
+		output << false;
+}
+
 
 // SerialTalks::ostream
 
@@ -36,17 +92,38 @@ void SerialTalks::ostream::begin(SerialTalks& parent, long retcode)
 {
 	m_parent = &parent;
 	m_retcode = retcode;
+	m_length = 0;
 }
 
 size_t SerialTalks::ostream::write(uint8_t c)
 {
-	uint8_t buffer[2] = {c, '\0'};
-	return write(buffer, 2);
+	// Keep one byte for the null-terminating character. The buffer may still be full if the last
+	// flush was held (see below).
+	if (m_length >= SERIALTALKS_LOG_BUFFER_SIZE - 1)
+		return 0;
+	m_buffer[m_length++] = c;
+	if (c == '\n' || m_length >= SERIALTALKS_LOG_BUFFER_SIZE - 1)
+		flush();
+	return 1;
 }
 
 size_t SerialTalks::ostream::write(const uint8_t *buffer, size_t size)
 {
-	return m_parent->sendback(m_retcode, buffer, size + 1);
+	for (size_t i = 0; i < size; i++)
+		write(buffer[i]);
+	return size;
+}
+
+void SerialTalks::ostream::flush()
+{
+	// The line waits for the response of the instruction being executed, unless there is room for
+	// both of them
+	if (m_length > 0 && m_parent->canLog(m_length + 1))
+	{
+		m_buffer[m_length] = '\0';
+		m_parent->sendback(m_retcode, m_buffer, m_length + 1);
+		m_length = 0;
+	}
 }
 
 
@@ -57,6 +134,25 @@ void SerialTalks::begin(Stream& stream)
 	// Initialize attributes
 	m_stream = &stream;
 	m_connected = false;
+	m_serial = 0;
+	m_bindings = 0;
+	m_numBindings = 0;
+	m_baudrate = SERIALTALKS_BAUDRATE;
+	m_pendingBaudrate = 0;
+	m_lastFrameTime = millis();
+	m_txHead = 0;
+	m_txLength = 0;
+	m_txDropped = 0;
+	m_holdingLogs = false;
+	m_batchCount = 0;
+	m_budget = 0;
+	m_budgetTime = millis();
+	m_bandwidth = SERIALTALKS_BAUDRATE / 10 / SERIALTALKS_SUBSCRIPTIONS_SHARE;
+	for (int i = 0; i < SERIALTALKS_REPLAY_CACHE_SIZE; i++)
+	{
+		m_responses[i].size = SERIALTALKS_UNREPLAYABLE_RESPONSE;
+		m_responses[i].frames = 0;
+	}
 	out.begin(*this, SERIALTALKS_STDOUT_RETCODE);
 	err.begin(*this, SERIALTALKS_STDERR_RETCODE);
 
@@ -71,11 +167,25 @@ void SerialTalks::begin(Stream& stream)
 		setUUID(uuid);
 	}
 #endif // BOARD_UUID
+}
+
+void SerialTalks::begin(HardwareSerial& serial)
+{
+	begin((Stream&)(serial));
+	m_serial = &serial;
+}
 
-	// Add UUID accessors
-	bind(SERIALTALKS_PING_OPCODE,    SerialTalks::PING);
-	bind(SERIALTALKS_GETUUID_OPCODE, SerialTalks::GETUUID);
-	bind(SERIALTALKS_SETUUID_OPCODE, SerialTalks::SETUUID);
+void SerialTalks::setBaudrate(unsigned long baudrate)
+{
+	// Wait for the pending bytes to be sent
+	while (m_txLength > 0)
+		drain();
+	m_serial->flush();
+	m_serial->begin(baudrate);
+	m_baudrate = baudrate;
+	m_bandwidth = baudrate / 10 / SERIALTALKS_SUBSCRIPTIONS_SHARE; // 10 bits per byte
+	m_lastFrameTime = millis();
+	m_state = SERIALTALKS_WAITING_STATE;
 }
 
 int SerialTalks::sendback(long retcode, const byte* buffer, int size)
@@ -83,19 +193,135 @@ int SerialTalks::sendback(long retcode, const byte* buffer, int size)
 	int count = 0;
 	if (m_stream != 0 && isConnected())
 	{
-		count += m_stream->write(SERIALTALKS_SLAVE_BYTE);
-		count += m_stream->write(byte(sizeof(retcode) + size));
-		count += m_stream->write((byte*)(&retcode), sizeof(retcode));
-		count += m_stream->write(buffer, size);	
+		const int32_t wireRetcode = retcode; // A long is 32-bit on the boards but not on the host
+		const unsigned int frameSize = 2 + sizeof(wireRetcode) + size;
+		if (SERIALTALKS_TX_BUFFER_SIZE - m_txLength < frameSize)
+		{
+			m_txDropped++;
+			return 0;
+		}
+		const byte header[2] = {SERIALTALKS_SLAVE_BYTE, byte(sizeof(wireRetcode) + size)};
+		enqueue(header, sizeof(header));
+		enqueue((byte*)(&wireRetcode), sizeof(wireRetcode));
+		enqueue(buffer, size);
+		drain();
+		count = frameSize;
 	}
 	return count;
 }
 
+void SerialTalks::enqueue(const byte* buffer, int size)
+{
+	unsigned int tail = (m_txHead + m_txLength) % SERIALTALKS_TX_BUFFER_SIZE;
+	for (int i = 0; i < size; i++)
+	{
+		m_txBuffer[tail++] = buffer[i];
+		if (tail >= SERIALTALKS_TX_BUFFER_SIZE)
+			tail = 0;
+	}
+	m_txLength += size;
+}
+
+void SerialTalks::drain()
+{
+	// Only write what the hardware serial can take without blocking. Other streams don't tell
+	// so everything is written at once.
+	unsigned int count = m_txLength;
+	if (m_serial != 0)
+	{
+		int room = m_serial->availableForWrite();
+		if (room < 0)
+			room = 0;
+		if (count > (unsigned int)(room))
+			count = room;
+	}
+
+	// The pending bytes may wrap around the end of the buffer
+	while (count > 0)
+	{
+		unsigned int chunk = SERIALTALKS_TX_BUFFER_SIZE - m_txHead;
+		if (chunk > count)
+			chunk = count;
+		m_stream->write(m_txBuffer + m_txHead, chunk);
+		m_txHead = (m_txHead + chunk) % SERIALTALKS_TX_BUFFER_SIZE;
+		m_txLength -= chunk;
+		count -= chunk;
+	}
+}
+
+void SerialTalks::pushSubscriptions()
+{
+	const long frameOverhead = 2 + sizeof(int32_t); // Slave byte, frame length and retcode
+	unsigned long currentTime = millis();
+
+	// Refill the bus budget according to the elapsed time
+	long gain = (long(currentTime) - m_budgetTime) * m_bandwidth / 1000;
+	if (gain > 0)
+	{
+		m_budget += gain;
+		m_budgetTime += gain * 1000 / m_bandwidth;
+	}
+	if (m_budget >= 2 * (frameOverhead + SERIALTALKS_OUTPUT_BUFFER_SIZE))
+	{
+		m_budget = 2 * (frameOverhead + SERIALTALKS_OUTPUT_BUFFER_SIZE);
+		m_budgetTime = currentTime;
+	}
+
+	for (int i = 0; i < SERIALTALKS_MAX_SUBSCRIPTIONS; i++)
+	{
+		Subscription& subscription = m_subscriptions[i];
+		if (subscription.period == 0 || currentTime - subscription.lastTime < subscription.period)
+			continue;
+
+		// Postpone the push until the budget and the transmit buffer allow it
+		if (m_budget < frameOverhead + subscription.size || !canRespond())
+			continue;
+
+		Deserializer input (m_inputBuffer);
+		Serializer   output(m_outputBuffer);
+		m_holdingLogs = true;
+		getInstruction(subscription.opcode)(*this, input, output);
+		subscription.size = output.buffer - m_outputBuffer;
+		subscription.lastTime = currentTime;
+		if (subscription.size > 0)
+		{
+			sendback(subscription.retcode, m_outputBuffer, subscription.size);
+			m_budget -= frameOverhead + subscription.size;
+		}
+		releaseLogs();
+	}
+}
+
+SerialTalks::Instruction SerialTalks::getInstruction(byte opcode) const
+{
+	switch (opcode)
+	{
+	case SERIALTALKS_PING_OPCODE:        return SerialTalks::PING;
+	case SERIALTALKS_GETUUID_OPCODE:     return SerialTalks::GETUUID;
+	case SERIALTALKS_SETUUID_OPCODE:     return SerialTalks::SETUUID;
+	case SERIALTALKS_SUBSCRIBE_OPCODE:   return SerialTalks::SUBSCRIBE;
+	case SERIALTALKS_UNSUBSCRIBE_OPCODE: return SerialTalks::UNSUBSCRIBE;
+	case SERIALTALKS_SETBAUDRATE_OPCODE: return SerialTalks::SETBAUDRATE;
+	}
+#if SERIALTALKS_MAX_OPCODE > 0
+	if (opcode < SERIALTALKS_MAX_OPCODE && m_instructions[opcode] != 0)
+		return m_instructions[opcode];
+#endif // SERIALTALKS_MAX_OPCODE
+	for (byte i = 0; i < m_numBindings; i++)
+	{
+		if (pgm_read_byte(&m_bindings[i].opcode) == opcode)
+			return (Instruction)(pgm_read_ptr(&m_bindings[i].instruction));
+	}
+	return 0;
+}
+
 void SerialTalks::bind(byte opcode, Instruction instruction)
 {
 	// Add a command to execute when receiving the specified opcode
+#if SERIALTALKS_MAX_OPCODE > 0
 	if (opcode < SERIALTALKS_MAX_OPCODE)
 		m_instructions[opcode] = instruction;
+#endif // SERIALTALKS_MAX_OPCODE
 }
 
 bool SerialTalks::execinstruction(byte* inputBuffer)
@@ -104,29 +330,163 @@ bool SerialTalks::execinstruction(byte* inputBuffer)
 	Serializer   output(m_outputBuffer);
 	byte opcode = input.read<byte>();
 	long retcode = input.read<long>();
-	if (m_instructions[opcode] != 0)
+	if (opcode != SERIALTALKS_PING_OPCODE && replay(retcode, opcode == SERIALTALKS_BATCH_OPCODE))
+		return true;
+	if (opcode == SERIALTALKS_BATCH_OPCODE)
+	{
+		m_batchRetcode = retcode;
+		m_batchCount   = input.read<byte>();
+		m_batchRecord  = input.buffer;
+		return execbatch();
+	}
+	Instruction instruction = getInstruction(opcode);
+	if (instruction != 0)
 	{
-		m_instructions[opcode](*this, input, output);
+		m_holdingLogs = true;
+		instruction(*this, input, output);
 		if (output.buffer > m_outputBuffer)
-			sendback(retcode, m_outputBuffer, output.buffer - m_outputBuffer);
+			respond(retcode, m_outputBuffer, output.buffer - m_outputBuffer);
+		releaseLogs();
 		return true;
 	}
 	return false;
 }
 
-bool SerialTalks::execute()
+bool SerialTalks::replay(long retcode, bool batch)
+{
+	// Move the response with the same retcode (or the least recently used one if there is none)
+	// to the front of the cache
+	int i = 0;
+	while (i < SERIALTALKS_REPLAY_CACHE_SIZE - 1 && m_responses[i].retcode != retcode)
+		i++;
+	Response response = m_responses[i];
+	memmove(&m_responses[1], &m_responses[0], i * sizeof(Response));
+	m_responses[0] = response;
+
+	// Replay it if the instruction was already executed, in as many frames as the first time
+	if (response.retcode == retcode && response.size != SERIALTALKS_UNREPLAYABLE_RESPONSE)
+	{
+		if (response.frames == 1)
+			sendback(retcode, response.data, response.size);
+		else
+			for (int k = 0; k < response.size; k += 1 + response.data[k])
+				sendback(retcode, response.data + k, 1 + response.data[k]);
+		return true;
+	}
+	if (response.retcode == retcode && batch && response.frames > 0)
+		return true; // Unreplayable but already executed
+
+	// Otherwise record the upcoming response
+	m_responses[0].retcode = retcode;
+	m_responses[0].size = 0;
+	m_responses[0].frames = 0;
+	return false;
+}
+
+int SerialTalks::respond(long retcode, const byte* buffer, int size)
+{
+	// Keep a copy of the response being recorded (see replay). Its frames must all fit in the room
+	// that is left for one response before executing the instruction.
+	Response& response = m_responses[0];
+	if (response.retcode == retcode && response.size != SERIALTALKS_UNREPLAYABLE_RESPONSE)
+	{
+		const unsigned int frameOverhead = 2 + sizeof(int32_t);
+		const unsigned int replaySize = response.size + size + (response.frames + 1) * frameOverhead;
+		if (response.size + size <= SERIALTALKS_REPLAY_DATA_SIZE && replaySize <= frameOverhead + SERIALTALKS_OUTPUT_BUFFER_SIZE)
+		{
+			memcpy(response.data + response.size, buffer, size);
+			response.size += size;
+		}
+		else
+			response.size = SERIALTALKS_UNREPLAYABLE_RESPONSE;
+		response.frames++;
+	}
+	return sendback(retcode, buffer, size);
+}
+
+void SerialTalks::releaseLogs()
+{
+	// Send the lines held while the instruction was executed (see ostream::flush)
+	m_holdingLogs = false;
+	out.flush();
+	err.flush();
+}
+
+bool SerialTalks::execpending()
+{
+	// Execute the received frame, or carry on with its batch, once there is room for a response
+	if (!canRespond())
+		return false;
+	if (m_state == SERIALTALKS_INSTRUCTION_PENDING_STATE)
+	{
+		m_state = SERIALTALKS_WAITING_STATE;
+		return execinstruction(m_inputBuffer);
+	}
+	if (m_batchCount > 0)
+		return execbatch();
+	return false;
+}
+
+bool SerialTalks::execbatch()
 {
+	// A batch frame holds several instructions which are executed back to back. Its content is
+	// a records count followed by the records themselves: each one is its size, its opcode and its
+	// arguments. The outputs are sent back in the same way: a size followed by the output of the
+	// corresponding record, one record per frame with the same retcode. The output of a record
+	// may be as big as the output buffer minus its size byte, so it can't share it with another.
+	// The remaining records wait for the next execute if the transmit buffer is full.
+	const byte* end = m_inputBuffer + m_bytesNumber;
+	while (m_batchCount > 0 && canRespond())
+	{
+		Deserializer input(m_batchRecord);
+		byte  size   = input.read<byte>();
+		byte* record = input.buffer;
+		if (size == 0 || record + size > end)
+		{
+			m_batchCount = 0;
+			break;
+		}
+
+		// Nested batches are not allowed
+		Deserializer args(record);
+		Serializer   output(m_outputBuffer);
+		byte opcode = args.read<byte>();
+		Instruction instruction = getInstruction(opcode);
+		byte* outputSize = output.buffer++;
+		m_holdingLogs = true;
+		if (instruction != 0 && opcode != SERIALTALKS_BATCH_OPCODE)
+			instruction(*this, args, output);
+		*outputSize = output.buffer - outputSize - 1;
+		respond(m_batchRetcode, m_outputBuffer, output.buffer - m_outputBuffer);
+		releaseLogs();
+		m_batchRecord = record + size;
+		m_batchCount--;
+	}
+	return true;
+}
+
+bool SerialTalks::execute(unsigned long timeBudget, int maxInstructions)
+{
+	Profiler::Probe probe(this);
+
 	bool ret = false;
 	int length = m_stream->available();
+	unsigned long startTime = micros();
+	int numInstructions = 0;
+
+	// Write the pending outgoing bytes and carry on with the frame that was waiting for room
+	drain();
+	ret |= execpending();
+	bool exhausted = (m_state == SERIALTALKS_INSTRUCTION_PENDING_STATE || m_batchCount > 0);
 
 	long currentTime = millis();
-	if (m_state != SERIALTALKS_WAITING_STATE && currentTime - m_lastTime > 100) // 0.1s timeout
+	if (!exhausted && m_state != SERIALTALKS_WAITING_STATE && currentTime - m_lastTime > 100) // 0.1s timeout
 	{
 		// Abort previous communication
 		m_state = SERIALTALKS_WAITING_STATE;
 	}
 
-	for (int i = 0; i < length; i++)
+	for (int i = 0; i < length && !exhausted; i++)
 	{
 		// Read the incoming byte
 		byte inc = byte(m_stream->read());
@@ -156,19 +516,47 @@ bool SerialTalks::execute()
 			if (m_bytesCounter >= m_bytesNumber)
 			{
 				m_connected = true;
-				ret |= execinstruction(m_inputBuffer);
-				m_state = SERIALTALKS_WAITING_STATE;
+				m_lastFrameTime = currentTime;
+				m_state = SERIALTALKS_INSTRUCTION_PENDING_STATE;
+				ret |= execpending();
+
+				// Stop there if the caller has other deadlines to meet or if the frame has to
+				// wait for room in the transmit buffer
+				numInstructions++;
+				exhausted = (maxInstructions > 0 && numInstructions >= maxInstructions) ||
+				            (timeBudget > 0 && micros() - startTime >= timeBudget) ||
+				            m_state == SERIALTALKS_INSTRUCTION_PENDING_STATE || m_batchCount > 0;
 			}
+			continue;
+
+		// Not reached: no byte is read while a frame is pending
+		case SERIALTALKS_INSTRUCTION_PENDING_STATE:
+			continue;
 		}
 	}
+
+	// Push the subscribed instructions outputs
+	if (isConnected() && !exhausted)
+		pushSubscriptions();
+
+	// Apply the negotiated baudrate or fall back to the default one if the host went mute
+	if (m_pendingBaudrate != 0)
+	{
+		setBaudrate(m_pendingBaudrate);
+		m_pendingBaudrate = 0;
+	}
+	else if (m_baudrate != SERIALTALKS_BAUDRATE && millis() - m_lastFrameTime > SERIALTALKS_BAUDRATE_TIMEOUT)
+	{
+		setBaudrate(SERIALTALKS_BAUDRATE);
+	}
 	return ret;
 }
 
 bool SerialTalks::waitUntilConnected(float timeout)
 {
+	const uint32_t timeoutMicros = timeout * 1e6;
 	Clock clock;
-	clock.restart();
-	while (!isConnected() || (timeout > 0 && clock.getElapsedTime() < timeout))
+	while (!isConnected() || (timeout > 0 && clock.getElapsedMicros() < timeoutMicros))
 		execute();
 	return isConnected();
 }
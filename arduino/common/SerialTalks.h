@@ -8,6 +8,10 @@
 #define SERIALTALKS_BAUDRATE 19200
 #endif
 
+#ifndef SERIALTALKS_BAUDRATE_TIMEOUT
+#define SERIALTALKS_BAUDRATE_TIMEOUT 1000 // ms without any instruction before falling back to SERIALTALKS_BAUDRATE
+#endif
+
 #ifndef SERIALTALKS_INPUT_BUFFER_SIZE
 #define SERIALTALKS_INPUT_BUFFER_SIZE 64
 #endif
@@ -16,6 +20,18 @@
 #define SERIALTALKS_OUTPUT_BUFFER_SIZE 64
 #endif
 
+#ifndef SERIALTALKS_TX_BUFFER_SIZE
+#define SERIALTALKS_TX_BUFFER_SIZE 96
+#endif
+
+#if SERIALTALKS_TX_BUFFER_SIZE < 6 + SERIALTALKS_OUTPUT_BUFFER_SIZE // Slave byte, frame length and retcode
+#error "SERIALTALKS_TX_BUFFER_SIZE must hold a whole response frame"
+#endif
+
+#ifndef SERIALTALKS_LOG_BUFFER_SIZE
+#define SERIALTALKS_LOG_BUFFER_SIZE 32
+#endif
+
 #ifndef SERIALTALKS_UUID_ADDRESS
 #define SERIALTALKS_UUID_ADDRESS 0x0000000000
 #endif
@@ -25,7 +41,23 @@
 #endif
 
 #ifndef SERIALTALKS_MAX_OPCODE
-#define SERIALTALKS_MAX_OPCODE 0x10
+#define SERIALTALKS_MAX_OPCODE 0 // Size of the RAM instructions table (see SerialTalks::Binding)
+#endif
+
+#ifndef SERIALTALKS_MAX_SUBSCRIPTIONS
+#define SERIALTALKS_MAX_SUBSCRIPTIONS 4
+#endif
+
+#ifndef SERIALTALKS_SUBSCRIPTIONS_SHARE
+#define SERIALTALKS_SUBSCRIPTIONS_SHARE 4 // the pushes take at most a quarter of the link
+#endif
+
+#ifndef SERIALTALKS_REPLAY_CACHE_SIZE
+#define SERIALTALKS_REPLAY_CACHE_SIZE 4 // number of responses kept for retransmitted instructions
+#endif
+
+#ifndef SERIALTALKS_REPLAY_DATA_SIZE
+#define SERIALTALKS_REPLAY_DATA_SIZE 16 // bigger responses are not kept
 #endif
 
 #define SERIALTALKS_MASTER_BYTE 'R'
@@ -36,6 +68,14 @@
 #define SERIALTALKS_PING_OPCODE    0x0
 #define SERIALTALKS_GETUUID_OPCODE 0x1
 #define SERIALTALKS_SETUUID_OPCODE 0x2
+
+// Reserved opcodes: they are handled by SerialTalks itself whatever the sketch binds
+#define SERIALTALKS_FIRST_RESERVED_OPCODE 0xF0
+#define SERIALTALKS_SUBSCRIBE_OPCODE   0xF0
+#define SERIALTALKS_UNSUBSCRIBE_OPCODE 0xF1
+#define SERIALTALKS_BATCH_OPCODE       0xF2
+#define SERIALTALKS_SETBAUDRATE_OPCODE 0xF3
+
 #define SERIALTALKS_STDOUT_RETCODE 0xFFFFFFFF
 #define SERIALTALKS_STDERR_RETCODE 0xFFFFFFFE
 
@@ -51,6 +91,8 @@ public: // Public API
 		virtual size_t write(uint8_t);
 		virtual size_t write(const uint8_t *buffer, size_t size);
 
+		virtual void flush(); // Send the pending characters right now
+
 		template<typename T> ostream& operator<<(const T& object)
 		{
 			print(object);
@@ -64,20 +106,64 @@ public: // Public API
 		SerialTalks* m_parent;
 		long         m_retcode;
 
+		// Characters are staged here and sent as a single frame at each end of line (or when the
+		// buffer is full) rather than one frame per character.
+		byte         m_buffer[SERIALTALKS_LOG_BUFFER_SIZE];
+		byte         m_length;
+
 		friend class SerialTalks;
 	};
 
 	typedef void (*Instruction)(SerialTalks& inst, Deserializer& input, Serializer& output);
 
+	// The instructions are meant to be declared in a table that lives in flash memory:
+	//
+	//     constexpr SerialTalks::Binding instructions[] PROGMEM = {{OPCODE, INSTRUCTION}, ...};
+	//     static_assert(SerialTalks::checkBindings(instructions), "...");
+	//
+	// while `bind(opcode, instruction)` registers them in RAM at run time. The latter is only
+	// available if SERIALTALKS_MAX_OPCODE is not null and takes precedence over the former.
+	struct Binding
+	{
+		byte        opcode;
+		Instruction instruction;
+	};
+
 	void begin(Stream& stream);
+	void begin(HardwareSerial& serial); // Allow the host to change the baudrate
 
 	void bind(byte opcode, Instruction instruction);
 
+	template<size_t N> void bind(const Binding (&bindings)[N]){m_bindings = bindings; m_numBindings = N;}
+
+	static constexpr bool isReservedOpcode(byte opcode)
+	{
+		return opcode <= SERIALTALKS_SETUUID_OPCODE || opcode >= SERIALTALKS_FIRST_RESERVED_OPCODE;
+	}
+
+	// Check at compile time that a bindings table has neither reserved nor duplicated opcodes
+	template<size_t N> static constexpr bool checkBindings(const Binding (&bindings)[N])
+	{
+		return checkBindings(bindings, N, 0);
+	}
+
 	bool execinstruction(byte* inputBuffer);
-	bool execute();
+
+	// Process the incoming bytes. A non-null time budget (in microseconds) or instructions limit makes it
+	// return as soon as one of them is exceeded, leaving the remaining bytes in the stream for the
+	// next call. The budget is checked after each instruction, so it may be overrun by the
+	// duration of one instruction. It also returns when the transmit buffer has no room left
+	// for a response, and carries on with the received frame at the next call.
+	bool execute(unsigned long timeBudget = 0, int maxInstructions = 0);
+
+	int getPendingBytes() {return m_stream->available();}
 
 	bool isConnected() const {return m_connected;}
 
+	unsigned long getBaudrate() const {return m_baudrate;}
+
+	unsigned int getDroppedFrames() const {return m_txDropped;}
+
 	bool waitUntilConnected(float timeout = -1);
 
 	bool getUUID(char* uuid);
@@ -93,33 +179,121 @@ public: // Public API
 protected: // Protected methods
 
 	int sendback(long retcode, const byte* buffer, int size);
+	int respond (long retcode, const byte* buffer, int size);
+
+	bool replay(long retcode, bool batch);
+
+	void enqueue(const byte* buffer, int size);
+	void drain();
+
+	Instruction getInstruction(byte opcode) const;
+
+	bool canRespond() const {return SERIALTALKS_TX_BUFFER_SIZE - m_txLength >= 2 + sizeof(int32_t) + SERIALTALKS_OUTPUT_BUFFER_SIZE;}
+	bool canLog(int size) const {return !m_holdingLogs || SERIALTALKS_TX_BUFFER_SIZE - m_txLength >= 2 * (2 + sizeof(int32_t)) + size + SERIALTALKS_OUTPUT_BUFFER_SIZE;}
+	void releaseLogs();
+
+	bool execpending();
+	bool execbatch();
+
+	void pushSubscriptions();
+
+	void setBaudrate(unsigned long baudrate);
 
 	// Attributes
 
 	Stream*     m_stream;
 	bool		m_connected;
 
+	HardwareSerial* m_serial;          // Only set if the baudrate can be changed
+	unsigned long   m_baudrate;
+	unsigned long   m_pendingBaudrate; // Applied once the acknowledgement has been sent
+	unsigned long   m_lastFrameTime;   // in ms
+
+#if SERIALTALKS_MAX_OPCODE > 0
 	Instruction	m_instructions[SERIALTALKS_MAX_OPCODE];
+#endif // SERIALTALKS_MAX_OPCODE
+
+	const Binding* m_bindings; // in flash memory
+	byte           m_numBindings;
 
 	byte        m_inputBuffer [SERIALTALKS_INPUT_BUFFER_SIZE];
 	byte        m_outputBuffer[SERIALTALKS_OUTPUT_BUFFER_SIZE];
 
+	// Outgoing frames are queued here and written without ever waiting for the stream to be
+	// ready. Instructions are only executed once there is room for their response, so that only
+	// the logs may not fit, in which case they are dropped as a whole.
+	byte         m_txBuffer[SERIALTALKS_TX_BUFFER_SIZE];
+	unsigned int m_txHead;
+	unsigned int m_txLength;
+	unsigned int m_txDropped;
+	bool         m_holdingLogs; // while an instruction runs, until its response is queued
+
 	enum //     m_state
 	{
 		SERIALTALKS_WAITING_STATE,
 		SERIALTALKS_INSTRUCTION_STARTING_STATE,
 		SERIALTALKS_INSTRUCTION_RECEIVING_STATE,
+		SERIALTALKS_INSTRUCTION_PENDING_STATE, // Received but waiting for room in m_txBuffer
 	}           m_state;
 	
 	byte        m_bytesNumber;
 	byte        m_bytesCounter;
 	long        m_lastTime;
 
+	// The batch frame being executed: its remaining records wait in m_inputBuffer when
+	// m_txBuffer lacks room for their responses
+	long        m_batchRetcode;
+	byte*       m_batchRecord;
+	byte        m_batchCount;
+
+	// Subscriptions make the board execute an instruction periodically and push its output to
+	// the host without being asked. A free slot has a null period.
+	struct Subscription
+	{
+		byte          opcode;
+		unsigned int  period;   // in ms
+		long          retcode;
+		unsigned long lastTime; // in ms
+		byte          size;     // size of the last pushed output
+	}           m_subscriptions[SERIALTALKS_MAX_SUBSCRIPTIONS];
+
+	long        m_budget;     // in bytes, so that the pushes never saturate the link
+	long        m_budgetTime; // in ms
+	long        m_bandwidth;  // in bytes/s, at the current baudrate
+
+	// The last responses, the most recent first. The host sends an instruction again with the
+	// same retcode when it missed the response, in which case it is replayed from here rather
+	// than executing the instruction twice. Responses that don't fit are marked as unreplayable
+	// and their instructions are executed again: they are meant to be getters. Batches may hold
+	// setters, so an unreplayable one is not executed again nor answered.
+	struct Response
+	{
+		long retcode;
+		byte size;   // 0xFF if unreplayable
+		byte frames; // a batch sends one per record, each one starting with its size
+		byte data[SERIALTALKS_REPLAY_DATA_SIZE];
+	}           m_responses[SERIALTALKS_REPLAY_CACHE_SIZE];
+
 private:
 
+	static constexpr bool isUniqueOpcode(const Binding* bindings, size_t count, size_t i, size_t j)
+	{
+		return j >= count || (bindings[i].opcode != bindings[j].opcode && isUniqueOpcode(bindings, count, i, j + 1));
+	}
+
+	static constexpr bool checkBindings(const Binding* bindings, size_t count, size_t i)
+	{
+		return i >= count || (!isReservedOpcode(bindings[i].opcode) && isUniqueOpcode(bindings, count, i, i + 1) && checkBindings(bindings, count, i + 1));
+	}
+
 	static void PING   (SerialTalks& talks, Deserializer& input, Serializer& output);
 	static void GETUUID(SerialTalks& talks, Deserializer& input, Serializer& output);
 	static void SETUUID(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+	static void SUBSCRIBE  (SerialTalks& talks, Deserializer& input, Serializer& output);
+	static void UNSUBSCRIBE(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+	static void SETBAUDRATE(SerialTalks& talks, Deserializer& input, Serializer& output);
 };
 
 extern SerialTalks talks;
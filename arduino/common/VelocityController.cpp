@@ -5,27 +5,39 @@
 #include "SerialTalks.h"
 #include "mathutils.h"
 
+#if ENABLE_VELOCITYCONTROLLER_LOGS
+#include "Scheduler.h"
+#endif // ENABLE_VELOCITYCONTROLLER_LOGS
 
-float VelocityController::genRampSetpoint(float stepSetpoint, float input, float rampSetpoint, float maxAcc, float maxDec, float timestep)
+
+template<typename T>
+T VelocityController::genRampSetpoint(T stepSetpoint, T input, T rampSetpoint, T maxAcc, T maxDec, T timestep)
 {
+	// The sign tests below are comparisons rather than products so that they hold for any T
+
 	// If we are above the desired setpoint (i.e. the ramp), we no longer try to follow it.
 	// Instead we generate a new ramp starting from our current position.
-	if ((input - rampSetpoint) * (stepSetpoint - rampSetpoint) > 0)
+	if ((input > rampSetpoint && stepSetpoint > rampSetpoint) || (input < rampSetpoint && stepSetpoint < rampSetpoint))
 		rampSetpoint = input;
 
 	// Do we have to accelerate or deccelerate to reach the desired setpoint?
-	if (input * (stepSetpoint - input) >= 0)
-		rampSetpoint += sign(stepSetpoint - input) * maxAcc * timestep;
-	else
-		rampSetpoint += sign(stepSetpoint - input) * maxDec * timestep;
+	const bool accelerate = (input >= 0) == (stepSetpoint >= input) || input == 0 || stepSetpoint == input;
+	const T delta = (accelerate ? maxAcc : maxDec) * timestep;
+	if (stepSetpoint > input)
+		rampSetpoint += delta;
+	else if (stepSetpoint < input)
+		rampSetpoint -= delta;
 
 	// We clamp the ramp so that it never exceeds the real setpoint
-	if ((stepSetpoint - input) * (stepSetpoint - rampSetpoint) < 0) // TODO: test if this condition runs well when rampSetpoint is set to INFINITY
+	if ((stepSetpoint > input && stepSetpoint < rampSetpoint) || (stepSetpoint < input && stepSetpoint > rampSetpoint))
 		rampSetpoint = stepSetpoint;
 
 	return rampSetpoint;
 }
 
+template float VelocityController::genRampSetpoint<float>(float, float, float, float, float, float);
+template Fixed VelocityController::genRampSetpoint<Fixed>(Fixed, Fixed, Fixed, Fixed, Fixed, Fixed);
+
 void VelocityController::process(float timestep)
 {
 	// Save setpoints
@@ -33,8 +45,8 @@ void VelocityController::process(float timestep)
 	const float stepAngVelSetpoint = m_angSetpoint;
 
 	// Compute new setpoints
-	m_rampLinVelSetpoint = genRampSetpoint(m_linSetpoint, m_linInput, m_rampLinVelSetpoint, m_maxLinAcc, m_maxLinDec, timestep);
-	m_rampAngVelSetpoint = genRampSetpoint(m_angSetpoint, m_angInput, m_rampAngVelSetpoint, m_maxAngAcc, m_maxAngDec, timestep);
+	m_rampLinVelSetpoint = float(genRampSetpoint<PID::Scalar>(m_linSetpoint, m_linInput, m_rampLinVelSetpoint, m_maxLinAcc, m_maxLinDec, timestep));
+	m_rampAngVelSetpoint = float(genRampSetpoint<PID::Scalar>(m_angSetpoint, m_angInput, m_rampAngVelSetpoint, m_maxAngAcc, m_maxAngDec, timestep));
 
 	// Do the engineering control
 	m_linSetpoint = m_rampLinVelSetpoint;
@@ -90,8 +102,16 @@ void VelocityController::save(int address) const
 #if ENABLE_VELOCITYCONTROLLER_LOGS
 void VelocityControllerLogs::process(float timestep)
 {
+	// Copy the controller state at once, as it is updated from the Timer1 interrupt, and print it
+	// without holding the lock
+	float linSetpoint, linInput, linOutput, angSetpoint, angInput, angOutput;
+	{
+		Scheduler::Lock lock;
+		linSetpoint = m_controller->m_rampLinVelSetpoint; linInput = m_controller->m_linInput; linOutput = m_controller->m_linVelOutput;
+		angSetpoint = m_controller->m_rampAngVelSetpoint; angInput = m_controller->m_angInput; angOutput = m_controller->m_angVelOutput;
+	}
 	talks.out << millis() << "\t";
-	talks.out << m_controller->m_rampLinVelSetpoint << "\t" << m_controller->m_linInput << "\t" << m_controller->m_linVelOutput << "\t";
-	talks.out << m_controller->m_rampAngVelSetpoint << "\t" << m_controller->m_angInput << "\t" << m_controller->m_angVelOutput << "\n";
+	talks.out << linSetpoint << "\t" << linInput << "\t" << linOutput << "\t";
+	talks.out << angSetpoint << "\t" << angInput << "\t" << angOutput << "\n";
 };
 #endif // ENABLE_VELOCITYCONTROLLER_LOGS
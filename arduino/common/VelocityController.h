@@ -25,12 +25,16 @@ public:
 	float getMaxAngDec() const {return m_maxAngDec;}
 	bool getSpinShutdown() const {return m_spinShutdown;}
 
+	float getRampLinVelSetpoint() const {return m_rampLinVelSetpoint;}
+	float getRampAngVelSetpoint() const {return m_rampAngVelSetpoint;}
+
 	void load(int address);
 	void save(int address) const;
 
 protected:
 
-	float genRampSetpoint(float stepSetpoint, float input, float rampSetpoint, float maxAcc, float maxDec, float timestep);
+	template<typename T>
+	static T genRampSetpoint(T stepSetpoint, T input, T rampSetpoint, T maxAcc, T maxDec, T timestep);
 
 	virtual void process(float timestep);
 	virtual void onProcessEnabling();
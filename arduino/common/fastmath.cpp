@@ -0,0 +1,141 @@
+#include <Arduino.h>
+
+#include "fastmath.h"
+
+#include <math.h>
+#include <string.h>
+
+// sin(i * pi / 512) * 65535 for i in [0, 256]: a quarter of sine wave in 256 steps
+static const uint16_t SINE_TABLE[257] PROGMEM =
+{
+	    0,   402,   804,  1206,  1608,  2010,  2412,  2814,  3216,  3617,  4019,  4420,
+	 4821,  5222,  5623,  6023,  6424,  6824,  7223,  7623,  8022,  8421,  8820,  9218,
+	 9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391, 12785, 13179, 13573, 13966,
+	14359, 14751, 15142, 15533, 15924, 16313, 16703, 17091, 17479, 17866, 18253, 18639,
+	19024, 19408, 19792, 20175, 20557, 20939, 21319, 21699, 22078, 22456, 22834, 23210,
+	23586, 23960, 24334, 24707, 25079, 25450, 25820, 26189, 26557, 26925, 27291, 27656,
+	28020, 28383, 28745, 29106, 29465, 29824, 30181, 30538, 30893, 31247, 31600, 31952,
+	32302, 32651, 32999, 33346, 33692, 34036, 34379, 34721, 35061, 35400, 35738, 36074,
+	36409, 36743, 37075, 37406, 37736, 38064, 38390, 38715, 39039, 39361, 39682, 40001,
+	40319, 40635, 40950, 41263, 41575, 41885, 42194, 42500, 42806, 43109, 43411, 43712,
+	44011, 44308, 44603, 44897, 45189, 45479, 45768, 46055, 46340, 46624, 46905, 47185,
+	47464, 47740, 48014, 48287, 48558, 48827, 49095, 49360, 49624, 49885, 50145, 50403,
+	50659, 50913, 51166, 51416, 51664, 51911, 52155, 52398, 52638, 52877, 53113, 53348,
+	53580, 53811, 54039, 54266, 54490, 54713, 54933, 55151, 55367, 55582, 55794, 56003,
+	56211, 56417, 56620, 56822, 57021, 57218, 57413, 57606, 57797, 57985, 58171, 58356,
+	58537, 58717, 58895, 59070, 59243, 59414, 59582, 59749, 59913, 60075, 60234, 60391,
+	60546, 60699, 60850, 60998, 61144, 61287, 61429, 61567, 61704, 61838, 61970, 62100,
+	62227, 62352, 62475, 62595, 62713, 62829, 62942, 63053, 63161, 63267, 63371, 63472,
+	63571, 63668, 63762, 63853, 63943, 64030, 64114, 64196, 64276, 64353, 64428, 64500,
+	64570, 64638, 64703, 64765, 64826, 64883, 64939, 64992, 65042, 65090, 65136, 65179,
+	65219, 65258, 65293, 65327, 65357, 65386, 65412, 65435, 65456, 65475, 65491, 65504,
+	65515, 65524, 65530, 65534, 65535,
+};
+
+// atan(i / 128) * 65536 for i in [0, 128]
+static const uint16_t ARCTANGENT_TABLE[129] PROGMEM =
+{
+	    0,   512,  1024,  1536,  2047,  2559,  3070,  3580,  4091,  4600,  5110,  5618,
+	 6126,  6633,  7140,  7645,  8150,  8653,  9156,  9657, 10158, 10657, 11155, 11652,
+	12147, 12641, 13133, 13624, 14114, 14601, 15088, 15572, 16055, 16536, 17015, 17492,
+	17968, 18441, 18913, 19382, 19850, 20315, 20779, 21240, 21699, 22156, 22610, 23062,
+	23512, 23960, 24406, 24849, 25289, 25727, 26163, 26597, 27028, 27456, 27882, 28306,
+	28727, 29145, 29561, 29975, 30386, 30794, 31200, 31603, 32003, 32401, 32797, 33190,
+	33580, 33968, 34353, 34735, 35115, 35492, 35867, 36239, 36608, 36975, 37340, 37701,
+	38060, 38417, 38771, 39123, 39472, 39818, 40162, 40503, 40842, 41178, 41512, 41844,
+	42172, 42499, 42823, 43145, 43464, 43780, 44095, 44407, 44716, 45024, 45328, 45631,
+	45931, 46229, 46525, 46818, 47109, 47398, 47685, 47969, 48251, 48531, 48809, 49085,
+	49359, 49630, 49899, 50167, 50432, 50695, 50956, 51215, 51472,
+};
+
+#define SINE_STEPS_PER_RADIAN (512 / M_PI)
+
+// Sine of t / SINE_STEPS_PER_RADIAN
+static float sinSteps(float t)
+{
+	int32_t step = (int32_t)(t);
+	if (t < step) // Round towards -infinity
+		step--;
+	const float frac = t - step;
+
+	const uint8_t  index    = step & 0xFF;
+	const uint8_t  quadrant = (step >> 8) & 0x3;
+	uint16_t a, b;
+	if (quadrant & 0x1) // The second and fourth quadrants are mirrored
+	{
+		a = pgm_read_word(&SINE_TABLE[256 - index]);
+		b = pgm_read_word(&SINE_TABLE[255 - index]);
+	}
+	else
+	{
+		a = pgm_read_word(&SINE_TABLE[index]);
+		b = pgm_read_word(&SINE_TABLE[index + 1]);
+	}
+	const float value = (a + ((int32_t)(b) - a) * frac) * float(1.0 / 65535);
+	return (quadrant & 0x2) ? -value : value;
+}
+
+float fastsin(float x)
+{
+	return sinSteps(x * float(SINE_STEPS_PER_RADIAN));
+}
+
+float fastcos(float x)
+{
+	return sinSteps(x * float(SINE_STEPS_PER_RADIAN) + 256);
+}
+
+// Arctangent of z in [0, 1]
+static float atanUnit(float z)
+{
+	const float t = z * 128;
+	const uint8_t index = (uint8_t)(t);
+	if (index >= 128)
+		return M_PI / 4;
+	const float frac = t - index;
+	const uint16_t a = pgm_read_word(&ARCTANGENT_TABLE[index]);
+	const uint16_t b = pgm_read_word(&ARCTANGENT_TABLE[index + 1]);
+	return (a + (b - a) * frac) * float(1.0 / 65536);
+}
+
+float fastatan2(float y, float x)
+{
+	const float ax = abs(x);
+	const float ay = abs(y);
+	if (ax == 0 && ay == 0)
+		return 0;
+
+	// Reduce to the first octant, where the ratio is in [0, 1]
+	float angle = (ay <= ax) ? atanUnit(ay / ax) : float(M_PI / 2) - atanUnit(ax / ay);
+	if (x < 0)
+		angle = float(M_PI) - angle;
+	return (y < 0) ? -angle : angle;
+}
+
+float fastsqrt(float x)
+{
+	if (!(x > 0))
+		return 0;
+
+	// Estimate 1 / sqrt(x) from the float exponent and refine it with two Newton iterations, which
+	// don't divide
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	bits = 0x5F375A86 - (bits >> 1);
+	float y;
+	memcpy(&y, &bits, sizeof(y));
+	const float halfx = x * 0.5f;
+	y *= 1.5f - halfx * y * y;
+	y *= 1.5f - halfx * y * y;
+	return x * y;
+}
+
+float fastwrap(float x)
+{
+	// x - 2pi * floor((x + pi) / 2pi), with a truncation instead of floor
+	const float turns = (x + float(M_PI)) * float(0.5 / M_PI);
+	int32_t n = (int32_t)(turns);
+	if (turns < n)
+		n--;
+	return x - n * float(2 * M_PI);
+}
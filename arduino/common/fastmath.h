@@ -0,0 +1,30 @@
+#ifndef __FASTMATH_H__
+#define __FASTMATH_H__
+
+// Fast approximations of the libm functions used by the control loops.
+//
+// The avr-libc sin, cos and atan2 take between one and two thousand cycles each, and fmod even
+// more. These ones use small tables in the program memory with a linear interpolation, or a few
+// multiplications. Their maximum errors, over the whole range of the control loops (see the
+// accuracy report of the benchmarks sketch), are:
+//
+//   fastsin, fastcos  1.7e-5        (absolute, for |x| < 100 rad, growing with the float
+//                                    rounding of x beyond)
+//   fastatan2         1.2e-5 rad    (absolute)
+//   fastsqrt          4.7e-6        (relative)
+//   fastwrap          4.1e-6 rad    (absolute, for |x| < 100 rad)
+//
+// Odometry and PurePursuit use them instead of the libm when ODOMETRY_FASTMATH and
+// PUREPURSUIT_FASTMATH are set to 1.
+
+float fastsin(float x);
+
+float fastcos(float x);
+
+float fastatan2(float y, float x);
+
+float fastsqrt(float x);
+
+float fastwrap(float x); // in [-pi, pi[, like inrange(x, -M_PI, M_PI)
+
+#endif // __FASTMATH_H__
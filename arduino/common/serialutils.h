@@ -5,11 +5,63 @@
 #include <Arduino.h>
 #else
 #include <string>
+#include <math.h>
 typedef unsigned char byte;
 typedef std::string String;
 #endif
 
 
+// Compact types
+//
+// They hold a regular value but are written with fewer bytes than a float. The fixed-point ones
+// are 16-bit integers: values out of range are saturated and angles are wrapped to [-pi, pi).
+
+struct Millimeters // Distances in mm or velocities in mm/s: 1 mm resolution, [-32768, 32767] mm
+{
+	float value;
+
+	Millimeters(float value = 0) : value(value){}
+	operator float() const {return value;}
+};
+
+struct Radians // Angles in Q2.13 format: 0.12 mrad resolution
+{
+	float value;
+
+	Radians(float value = 0) : value(value){}
+	operator float() const {return value;}
+};
+
+struct RadiansPerSecond // Angular velocities in Q3.12 format: 0.24 mrad/s resolution, [-8, 8[ rad/s
+{
+	float value;
+
+	RadiansPerSecond(float value = 0) : value(value){}
+	operator float() const {return value;}
+};
+
+struct Varint // Zigzag-encoded signed integers: 1 to 5 bytes, small values in magnitude are shorter
+{
+	long value;
+
+	Varint(long value = 0) : value(value){}
+	operator long() const {return value;}
+};
+
+inline int toFixed16(float value, float scale)
+{
+	float raw = value * scale;
+	if (raw >= 32767) return 32767;
+	if (raw <= -32768) return -32768;
+	return (int)(raw >= 0 ? raw + 0.5f : raw - 0.5f);
+}
+
+inline float wrapAngle(float angle)
+{
+	return angle - 2 * M_PI * floor((angle + M_PI) / (2 * M_PI));
+}
+
+
 // Serializer
 
 struct Serializer
@@ -38,11 +90,69 @@ struct Serializer
 	}
 };
 
+#ifndef __AVR__
+// The frames follow the AVR data model wherever they are built: an int is written with 16 bits
+// and a long with 32 bits, even if they are wider here. The 32-bit integers are accessed directly
+// because int32_t is an int here.
+
+template<> inline void Serializer::write<int>(const int& integer)
+{
+	*(int16_t*)(buffer) = integer;
+	buffer += sizeof(int16_t);
+}
+
+template<> inline void Serializer::write<unsigned int>(const unsigned int& integer)
+{
+	*(uint16_t*)(buffer) = integer;
+	buffer += sizeof(uint16_t);
+}
+
+template<> inline void Serializer::write<long>(const long& integer)
+{
+	*(int32_t*)(buffer) = integer;
+	buffer += sizeof(int32_t);
+}
+
+template<> inline void Serializer::write<unsigned long>(const unsigned long& integer)
+{
+	*(uint32_t*)(buffer) = integer;
+	buffer += sizeof(uint32_t);
+}
+#endif // __AVR__
+
 template<> inline void Serializer::write<String>(const String& string)
 {
 	write(string.c_str());
 }
 
+template<> inline void Serializer::write<Millimeters>(const Millimeters& distance)
+{
+	write<int16_t>(toFixed16(distance.value, 1));
+}
+
+template<> inline void Serializer::write<Radians>(const Radians& angle)
+{
+	write<int16_t>(toFixed16(wrapAngle(angle.value), 8192));
+}
+
+template<> inline void Serializer::write<RadiansPerSecond>(const RadiansPerSecond& velocity)
+{
+	write<int16_t>(toFixed16(velocity.value, 4096));
+}
+
+template<> inline void Serializer::write<Varint>(const Varint& integer)
+{
+	// Zigzag encoding maps 0, -1, 1, -2... to 0, 1, 2, 3... Then each byte holds 7 bits, the
+	// least significant ones first, with the MSB set if more bytes follow.
+	uint32_t zigzag = ((uint32_t)(integer.value) << 1) ^ (uint32_t)(integer.value < 0 ? -1 : 0);
+	while (zigzag >= 0x80)
+	{
+		write<byte>(byte(zigzag) | 0x80);
+		zigzag >>= 7;
+	}
+	write<byte>(byte(zigzag));
+}
+
 
 // Deserializer
 
@@ -74,6 +184,34 @@ struct Deserializer
 	}
 };
 
+#ifndef __AVR__
+// See the Serializer
+
+template<> inline int Deserializer::read<int>()
+{
+	return read<int16_t>();
+}
+
+template<> inline unsigned int Deserializer::read<unsigned int>()
+{
+	return read<uint16_t>();
+}
+
+template<> inline long Deserializer::read<long>()
+{
+	int32_t integer = *(int32_t*)(buffer);
+	buffer += sizeof(int32_t);
+	return integer;
+}
+
+template<> inline unsigned long Deserializer::read<unsigned long>()
+{
+	uint32_t integer = *(uint32_t*)(buffer);
+	buffer += sizeof(uint32_t);
+	return integer;
+}
+#endif // __AVR__
+
 template<> inline String Deserializer::read<String>()
 {
 	String string((char*)(buffer));
@@ -81,4 +219,34 @@ template<> inline String Deserializer::read<String>()
 	return string; 
 }
 
+template<> inline Millimeters Deserializer::read<Millimeters>()
+{
+	return Millimeters(read<int16_t>());
+}
+
+template<> inline Radians Deserializer::read<Radians>()
+{
+	return Radians(read<int16_t>() / 8192.0f);
+}
+
+template<> inline RadiansPerSecond Deserializer::read<RadiansPerSecond>()
+{
+	return RadiansPerSecond(read<int16_t>() / 4096.0f);
+}
+
+template<> inline Varint Deserializer::read<Varint>()
+{
+	uint32_t zigzag = 0;
+	byte shift = 0;
+	byte inc;
+	do
+	{
+		inc = read<byte>();
+		zigzag |= (uint32_t)(inc & 0x7F) << shift;
+		shift += 7;
+	}
+	while ((inc & 0x80) && shift < 35);
+	return Varint((long)(zigzag >> 1) ^ -(long)(zigzag & 1));
+}
+
 #endif // __SERIALUTILS_H__
@@ -12,17 +12,23 @@ LedMatrix ledmatrix1;
 LedMatrix ledmatrix2;
 LedMatrix ledmatrix3;
 
+constexpr SerialTalks::Binding instructions[] PROGMEM =
+{
+	{SET_MATRIX_MESSAGE_OPCODE,         SET_MATRIX_MESSAGE},
+	{SET_IPDISPLAY_MESSAGE_OPCODE,      SET_IPDISPLAY_MESSAGE},
+	{SET_EEPROM_CHAR_IPDISPLAY_OPCODE,  SET_EEPROM_CHAR_IPDISPLAY},
+	{SET_SPEED_MATRIX_OPCODE,           SET_SPEED_MATRIX},
+	{SET_EEPROM_CHAR_LEDMATRIX_OPCODE,  SET_EEPROM_CHAR_LEDMATRIX},
+	{SET_EEPROM_DEFAULT_MESSAGE_OPCODE, SET_EEPROM_DEFAULT_MESSAGE},
+};
+static_assert(SerialTalks::checkBindings(instructions), "instructions opcodes must be unique and not reserved");
+
 void setup()
 {
 	Serial.begin(SERIALTALKS_BAUDRATE);
 	talks.begin(Serial);
 
-	talks.bind(SET_MATRIX_MESSAGE_OPCODE, SET_MATRIX_MESSAGE);
-	talks.bind(SET_IPDISPLAY_MESSAGE_OPCODE, SET_IPDISPLAY_MESSAGE);
-	talks.bind(SET_EEPROM_CHAR_IPDISPLAY_OPCODE,SET_EEPROM_CHAR_IPDISPLAY);
-	talks.bind(SET_SPEED_MATRIX_OPCODE,SET_SPEED_MATRIX);
-	talks.bind(SET_EEPROM_CHAR_LEDMATRIX_OPCODE,SET_EEPROM_CHAR_LEDMATRIX);
-	talks.bind(SET_EEPROM_DEFAULT_MESSAGE_OPCODE,SET_EEPROM_DEFAULT_MESSAGE);
+	talks.bind(instructions);
 
 	// Variables initialisation
 
@@ -165,6 +165,7 @@ void LedMatrix::initMatrix()
 void LedMatrix::computeBuffer(char buffer[])
 {
 	talks.out << "nouveau message : " << buffer;
+	talks.out.flush();
 	_pattern.clearPatterns();
 	int i;
 	for (i = 0; buffer[i]!='\0' && i < NB_PATTERNS_MAX; i++) {
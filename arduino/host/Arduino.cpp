@@ -0,0 +1,380 @@
+#include <Arduino.h>
+
+#include <chrono>
+#include <thread>
+
+
+// Time
+
+static bool     s_virtualTime   = false;
+static uint64_t s_virtualMicros = 0;
+
+static const std::chrono::steady_clock::time_point s_startTime = std::chrono::steady_clock::now();
+
+void HostClock::useVirtualTime(bool enabled)
+{
+	if (enabled && !s_virtualTime)
+		s_virtualMicros = getMicros(); // Don't go back in time
+	s_virtualTime = enabled;
+}
+
+bool HostClock::isVirtualTime()
+{
+	return s_virtualTime;
+}
+
+void HostClock::setMicros(uint64_t time)
+{
+	s_virtualMicros = time;
+}
+
+void HostClock::advanceMicros(uint64_t duration)
+{
+	s_virtualMicros += duration;
+}
+
+uint64_t HostClock::getMicros()
+{
+	if (s_virtualTime)
+		return s_virtualMicros;
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_startTime).count();
+}
+
+unsigned long micros()
+{
+	return uint32_t(HostClock::getMicros());
+}
+
+unsigned long millis()
+{
+	return uint32_t(HostClock::getMicros() / 1000);
+}
+
+void delay(unsigned long ms)
+{
+	if (s_virtualTime)
+		HostClock::advanceMicros(uint64_t(ms) * 1000);
+	else
+		std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	if (s_virtualTime)
+		HostClock::advanceMicros(us);
+	else if (us > 0)
+		std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+
+// Interrupts
+
+static bool s_interruptsEnabled = true;
+
+static void (*s_interruptHandlers[2])(void) = {0, 0};
+static int   s_interruptModes[2];
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode)
+{
+	if (interrupt < 2)
+	{
+		s_interruptHandlers[interrupt] = handler;
+		s_interruptModes   [interrupt] = mode;
+	}
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+	if (interrupt < 2)
+		s_interruptHandlers[interrupt] = 0;
+}
+
+void interrupts()
+{
+	s_interruptsEnabled = true;
+}
+
+void noInterrupts()
+{
+	s_interruptsEnabled = false;
+}
+
+
+// Digital and analog I/O
+
+static uint8_t s_pinModes   [NUM_DIGITAL_PINS];
+static uint8_t s_pinValues  [NUM_DIGITAL_PINS];
+static int     s_analogInputs[NUM_DIGITAL_PINS];
+static int     s_pwmOutputs [NUM_DIGITAL_PINS];
+
+static void changePin(uint8_t pin, uint8_t value)
+{
+	if (pin >= NUM_DIGITAL_PINS)
+		return;
+	uint8_t previous = s_pinValues[pin];
+	s_pinValues[pin] = (value != LOW) ? HIGH : LOW;
+
+	int interrupt = digitalPinToInterrupt(pin);
+	if (interrupt < 0 || !s_interruptsEnabled || s_interruptHandlers[interrupt] == 0 || previous == s_pinValues[pin])
+		return;
+	int mode = s_interruptModes[interrupt];
+	if (mode == CHANGE || (mode == RISING && s_pinValues[pin] == HIGH) || (mode == FALLING && s_pinValues[pin] == LOW))
+		s_interruptHandlers[interrupt]();
+}
+
+void HostPins::setDigital(uint8_t pin, uint8_t value)
+{
+	changePin(pin, value);
+}
+
+void HostPins::setAnalog(uint8_t pin, int value)
+{
+	if (pin < A0)
+		pin += A0;
+	if (pin < NUM_DIGITAL_PINS)
+		s_analogInputs[pin] = constrain(value, 0, 1023);
+}
+
+uint8_t HostPins::getMode(uint8_t pin)
+{
+	return (pin < NUM_DIGITAL_PINS) ? s_pinModes[pin] : INPUT;
+}
+
+uint8_t HostPins::getDigital(uint8_t pin)
+{
+	return (pin < NUM_DIGITAL_PINS) ? s_pinValues[pin] : LOW;
+}
+
+int HostPins::getPWM(uint8_t pin)
+{
+	return (pin < NUM_DIGITAL_PINS) ? s_pwmOutputs[pin] : 0;
+}
+
+void HostPins::reset()
+{
+	memset(s_pinModes,     INPUT, sizeof(s_pinModes));
+	memset(s_pinValues,    LOW,   sizeof(s_pinValues));
+	memset(s_analogInputs, 0,     sizeof(s_analogInputs));
+	memset(s_pwmOutputs,   0,     sizeof(s_pwmOutputs));
+	s_interruptHandlers[0] = s_interruptHandlers[1] = 0;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	if (pin >= NUM_DIGITAL_PINS)
+		return;
+	s_pinModes[pin] = mode;
+	if (mode == INPUT_PULLUP)
+		changePin(pin, HIGH);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+	if (pin >= NUM_DIGITAL_PINS)
+		return;
+	s_pwmOutputs[pin] = (value != LOW) ? 255 : 0;
+	changePin(pin, value);
+}
+
+int digitalRead(uint8_t pin)
+{
+	return HostPins::getDigital(pin);
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+	if (pin >= NUM_DIGITAL_PINS)
+		return;
+	s_pwmOutputs[pin] = constrain(value, 0, 255);
+	s_pinValues [pin] = (value >= 128) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+	if (pin < A0)
+		pin += A0;
+	return (pin < NUM_DIGITAL_PINS) ? s_analogInputs[pin] : 0;
+}
+
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder)
+{
+	uint8_t value = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		digitalWrite(clockPin, HIGH);
+		if (bitOrder == LSBFIRST)
+			value |= digitalRead(dataPin) << i;
+		else
+			value |= digitalRead(dataPin) << (7 - i);
+		digitalWrite(clockPin, LOW);
+	}
+	return value;
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		if (bitOrder == LSBFIRST)
+			digitalWrite(dataPin, (value >> i) & 1);
+		else
+			digitalWrite(dataPin, (value >> (7 - i)) & 1);
+		digitalWrite(clockPin, HIGH);
+		digitalWrite(clockPin, LOW);
+	}
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout)
+{
+	// The pins don't change by themselves: the pulse never comes
+	delayMicroseconds(timeout);
+	return 0;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+	return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+
+// Random numbers
+
+void randomSeed(unsigned long seed)
+{
+	if (seed != 0)
+		srandom(seed);
+}
+
+long random(long max)
+{
+	return (max > 0) ? ::random() % max : 0;
+}
+
+long random(long min, long max)
+{
+	return (min < max) ? random(max - min) + min : min;
+}
+
+
+// Strings
+
+static std::string toString(unsigned long value, int base)
+{
+	if (base < 2 || base > 36)
+		base = 10;
+	char buffer[8 * sizeof(long) + 1];
+	char* ptr = buffer + sizeof(buffer);
+	*--ptr = '\0';
+	do
+	{
+		int digit = value % base;
+		*--ptr = (digit < 10) ? '0' + digit : 'A' + digit - 10;
+		value /= base;
+	}
+	while (value > 0);
+	return ptr;
+}
+
+String::String(int value, int base) : String(long(value), base){}
+
+String::String(unsigned int value, int base) : String((unsigned long)(value), base){}
+
+String::String(long value, int base) : std::string((base == 10 && value < 0) ? "-" + toString(-(unsigned long)(value), base) : toString(value, base)){}
+
+String::String(unsigned long value, int base) : std::string(toString(value, base)){}
+
+String::String(double value, int decimals)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+	assign(buffer);
+}
+
+
+// Streams
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+	size_t count = 0;
+	while (count < size && write(buffer[count]))
+		count++;
+	return count;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length)
+{
+	// There is no timeout: only the bytes that are already available are read
+	size_t count = 0;
+	while (count < length && available() > 0)
+		buffer[count++] = char(read());
+	return count;
+}
+
+LoopbackStream::~LoopbackStream()
+{
+	disconnect();
+}
+
+void LoopbackStream::connect(LoopbackStream& peer)
+{
+	disconnect();
+	peer.disconnect();
+	m_peer = &peer;
+	peer.m_peer = this;
+}
+
+void LoopbackStream::disconnect()
+{
+	if (m_peer != 0)
+		m_peer->m_peer = 0;
+	m_peer = 0;
+}
+
+size_t LoopbackStream::write(uint8_t c)
+{
+	if (m_peer != 0)
+		m_peer->m_input.push_back(c);
+	return 1;
+}
+
+size_t LoopbackStream::write(const uint8_t* buffer, size_t size)
+{
+	if (m_peer != 0)
+		m_peer->m_input.insert(m_peer->m_input.end(), buffer, buffer + size);
+	return size;
+}
+
+int LoopbackStream::availableForWrite()
+{
+	int room = m_writeCapacity;
+	if (m_peer != 0)
+		room -= m_peer->m_input.size();
+	return (room > 0) ? room : 0;
+}
+
+int LoopbackStream::available()
+{
+	return m_input.size();
+}
+
+int LoopbackStream::read()
+{
+	if (m_input.empty())
+		return -1;
+	uint8_t c = m_input.front();
+	m_input.pop_front();
+	return c;
+}
+
+int LoopbackStream::peek()
+{
+	return m_input.empty() ? -1 : m_input.front();
+}
+
+HardwareSerial Serial;
+
+
+// AVR registers
+
+uint8_t TCCR0A, TCCR0B, TCCR1A, TCCR1B, TCCR2A, TCCR2B;
+uint8_t SREG;
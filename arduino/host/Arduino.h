@@ -0,0 +1,207 @@
+#ifndef __ARDUINO_H__
+#define __ARDUINO_H__
+
+// Host implementation of the Arduino core, so that the sketches and the common modules can be
+// built and run on Linux (see HostHAL.h for the test hooks).
+//
+// Beware that the data model is not the AVR one: `int` is 32-bit and `long` is 64-bit here
+// instead of 16-bit and 32-bit. The code behaves the same as long as it doesn't rely on the
+// integers widths: the SerialTalks frames still match the boards ones (see serialutils.h), but
+// the EEPROM layouts don't. For the same reason, micros() and millis() are truncated to 32 bits to
+// wrap around as on the boards.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+#include <string>
+
+#include <avr/pgmspace.h>
+
+typedef uint8_t  byte;
+typedef bool     boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define PI         3.1415926535897932384626433832795
+#define HALF_PI    1.5707963267948966192313216916398
+#define TWO_PI     6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+// Pins of an Arduino Nano
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define NUM_DIGITAL_PINS 22
+
+#define digitalPinToInterrupt(pin) ((pin) == 2 ? 0 : ((pin) == 3 ? 1 : -1))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define sq(x) ((x) * (x))
+
+#define bitRead(value, bit)  (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)   ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define _BV(bit) (1 << (bit))
+
+#define F(string) (string)
+
+using std::abs;
+
+template<typename A, typename B> auto min(A a, B b) -> decltype(a + b) {return (a < b) ? a : b;}
+template<typename A, typename B> auto max(A a, B b) -> decltype(a + b) {return (a > b) ? a : b;}
+
+// Time
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Digital and analog I/O
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int  digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+int  analogRead(uint8_t pin);
+
+uint8_t shiftIn (uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
+void    shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t value);
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+// Interrupts
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+void interrupts();
+void noInterrupts();
+
+// Random numbers
+
+void randomSeed(unsigned long seed);
+long random(long max);
+long random(long min, long max);
+
+// Strings
+
+class String : public std::string
+{
+public:
+
+	String(const char* string = "") : std::string(string){}
+	String(const std::string& string) : std::string(string){}
+	String(char c) : std::string(1, c){}
+	String(int value, int base = 10);
+	String(long value, int base = 10);
+	String(unsigned int value, int base = 10);
+	String(unsigned long value, int base = 10);
+	String(double value, int decimals = 2);
+
+	unsigned int length() const {return std::string::length();}
+
+	char charAt(unsigned int index) const {return (*this)[index];}
+
+	long  toInt()   const {return atol(c_str());}
+	float toFloat() const {return atof(c_str());}
+};
+
+// Streams
+
+class Print
+{
+public:
+
+	virtual ~Print(){}
+
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+	size_t write(const char* string){return (string != 0) ? write((const uint8_t*)(string), strlen(string)) : 0;}
+	size_t write(const char* buffer, size_t size){return write((const uint8_t*)(buffer), size);}
+
+	virtual int  availableForWrite(){return 0;}
+	virtual void flush(){}
+
+	size_t print(const char* string){return write(string);}
+	size_t print(const String& string){return write(string.c_str());}
+	size_t print(char c){return write(uint8_t(c));}
+	size_t print(unsigned char value, int base = 10){return print((unsigned long)(value), base);}
+	size_t print(int value, int base = 10){return print((long)(value), base);}
+	size_t print(unsigned int value, int base = 10){return print((unsigned long)(value), base);}
+	size_t print(long value, int base = 10){return print(String(value, base));}
+	size_t print(unsigned long value, int base = 10){return print(String(value, base));}
+	size_t print(double value, int decimals = 2){return print(String(value, decimals));}
+
+	template<typename T> size_t println(const T& value){return print(value) + println();}
+	template<typename T> size_t println(const T& value, int format){return print(value, format) + println();}
+	size_t println(){return write("\r\n");}
+};
+
+class Stream : public Print
+{
+public:
+
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+
+	size_t readBytes(char* buffer, size_t length);
+	size_t readBytes(uint8_t* buffer, size_t length){return readBytes((char*)(buffer), length);}
+};
+
+#include "HostHAL.h" // LoopbackStream
+
+class HardwareSerial : public LoopbackStream
+{
+public:
+
+	HardwareSerial() : m_baudrate(0){}
+
+	void begin(unsigned long baudrate){m_baudrate = baudrate;}
+	void end(){m_baudrate = 0;}
+
+	unsigned long getBaudrate() const {return m_baudrate;}
+
+	operator bool() const {return true;}
+
+private:
+
+	unsigned long m_baudrate;
+};
+
+extern HardwareSerial Serial;
+
+// AVR registers that the sketches write to (they have no effect here)
+
+extern uint8_t TCCR0A, TCCR0B, TCCR1A, TCCR1B, TCCR2A, TCCR2B;
+extern uint8_t SREG;
+
+#endif // __ARDUINO_H__
@@ -0,0 +1,50 @@
+#include <EEPROM.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+EEPROMClass EEPROM;
+
+static int s_fd = -1;
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+	address = wrap(address);
+	m_data[address] = value;
+	if (s_fd >= 0 && pwrite(s_fd, &value, 1, address) != 1)
+		perror("EEPROM");
+}
+
+bool HostEEPROM::open(const char* path)
+{
+	close();
+	int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return false;
+
+	// A new or short file is completed with blank cells
+	ssize_t count = pread(fd, EEPROM.m_data, EEPROM_SIZE, 0);
+	if (count < 0)
+		count = 0;
+	memset(EEPROM.m_data + count, 0xFF, EEPROM_SIZE - count);
+	if (count < EEPROM_SIZE && pwrite(fd, EEPROM.m_data + count, EEPROM_SIZE - count, count) < 0)
+	{
+		::close(fd);
+		return false;
+	}
+	s_fd = fd;
+	return true;
+}
+
+void HostEEPROM::close()
+{
+	if (s_fd >= 0)
+		::close(s_fd);
+	s_fd = -1;
+}
+
+void HostEEPROM::erase()
+{
+	for (int address = 0; address < EEPROM_SIZE; address++)
+		EEPROM.update(address, 0xFF);
+}
@@ -0,0 +1,81 @@
+#ifndef __EEPROM_H__
+#define __EEPROM_H__
+
+// In-memory EEPROM of an ATmega328P. It is blank (0xFF) at startup unless it is backed by a file
+// with HostEEPROM::open, in which case every write goes through to the file.
+
+#include <Arduino.h>
+
+#define EEPROM_SIZE 1024
+
+class EEPROMClass
+{
+public:
+
+	EEPROMClass(){memset(m_data, 0xFF, sizeof(m_data));}
+
+	uint8_t read(int address) const {return m_data[wrap(address)];}
+	void    write(int address, uint8_t value);
+	void    update(int address, uint8_t value){if (read(address) != value) write(address, value);}
+
+	uint16_t length() const {return EEPROM_SIZE;}
+
+	template<typename T> T& get(int address, T& value) const
+	{
+		uint8_t* ptr = (uint8_t*)(&value);
+		for (size_t i = 0; i < sizeof(T); i++)
+			ptr[i] = read(address + i);
+		return value;
+	}
+
+	template<typename T> const T& put(int address, const T& value)
+	{
+		const uint8_t* ptr = (const uint8_t*)(&value);
+		for (size_t i = 0; i < sizeof(T); i++)
+			update(address + i, ptr[i]);
+		return value;
+	}
+
+	// Writable reference to a cell, for `EEPROM[address] = value`
+	class Reference
+	{
+	public:
+
+		Reference(EEPROMClass& eeprom, int address) : m_eeprom(eeprom), m_address(address){}
+
+		operator uint8_t() const {return m_eeprom.read(m_address);}
+		Reference& operator=(uint8_t value){m_eeprom.update(m_address, value); return *this;}
+
+	private:
+
+		EEPROMClass& m_eeprom;
+		int          m_address;
+	};
+
+	Reference operator[](int address){return Reference(*this, address);}
+
+protected:
+
+	friend class HostEEPROM;
+
+	static int wrap(int address){return address & (EEPROM_SIZE - 1);}
+
+	uint8_t m_data[EEPROM_SIZE];
+};
+
+extern EEPROMClass EEPROM;
+
+
+class HostEEPROM
+{
+public:
+
+	// Load the EEPROM content from a file (created blank if needed) and keep it in sync. Return
+	// false if the file can't be opened.
+	static bool open(const char* path);
+	static void close();
+
+	static void erase(); // Fill the EEPROM with 0xFF
+};
+
+#endif // __EEPROM_H__
@@ -0,0 +1,81 @@
+#ifndef __HOSTHAL_H__
+#define __HOSTHAL_H__
+
+// Test hooks of the host Arduino core: they let the host side drive the time, the pins and the
+// serial link of the code under test.
+
+#include <Arduino.h>
+
+#include <deque>
+
+
+// Time: micros() and millis() follow the system monotonic clock by default. Once the virtual
+// clock is enabled they only change when it is set or advanced, and delay() advances it instead
+// of sleeping.
+
+class HostClock
+{
+public:
+
+	static void useVirtualTime(bool enabled = true);
+	static bool isVirtualTime();
+
+	static void     setMicros(uint64_t time);
+	static void     advanceMicros(uint64_t duration);
+	static uint64_t getMicros(); // Not truncated to 32 bits
+};
+
+
+// Pins: digitalWrite() and analogWrite() values can be read back, and inputs can be driven. A
+// change on pins 2 and 3 calls the attached interrupt handlers.
+
+class HostPins
+{
+public:
+
+	static void setDigital(uint8_t pin, uint8_t value);
+	static void setAnalog (uint8_t pin, int value);
+
+	static uint8_t getMode   (uint8_t pin);
+	static uint8_t getDigital(uint8_t pin);
+	static int     getPWM    (uint8_t pin); // Last analogWrite() value
+
+	static void reset();
+};
+
+
+// Serial: a loopback stream is one end of a link. What is written to it can be read from its
+// peer, and conversely. An unconnected stream discards what is written to it.
+
+class LoopbackStream : public Stream
+{
+public:
+
+	LoopbackStream() : m_peer(0), m_writeCapacity(64){}
+	virtual ~LoopbackStream();
+
+	void connect(LoopbackStream& peer);
+	void disconnect();
+
+	// Size of the modelled HardwareSerial TX buffer. availableForWrite() tells how much of it is
+	// not taken by the bytes the peer has yet to read, so that it drains as the peer reads.
+	void setWriteCapacity(int capacity){m_writeCapacity = capacity;}
+
+	virtual size_t write(uint8_t c);
+	virtual size_t write(const uint8_t* buffer, size_t size);
+	using Print::write;
+
+	virtual int availableForWrite();
+
+	virtual int available();
+	virtual int read();
+	virtual int peek();
+
+protected:
+
+	LoopbackStream*  m_peer;
+	int              m_writeCapacity;
+	std::deque<uint8_t> m_input;
+};
+
+#endif // __HOSTHAL_H__
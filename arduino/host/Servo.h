@@ -0,0 +1,40 @@
+#ifndef __SERVO_H__
+#define __SERVO_H__
+
+// Servo library stub: it only remembers the last command so that tests can read it back.
+
+#include <Arduino.h>
+
+#define MIN_PULSE_WIDTH     544
+#define MAX_PULSE_WIDTH     2400
+#define DEFAULT_PULSE_WIDTH 1500
+
+class Servo
+{
+public:
+
+	Servo() : m_pin(-1), m_pulseWidth(DEFAULT_PULSE_WIDTH){}
+
+	uint8_t attach(int pin){m_pin = pin; return 0;}
+	uint8_t attach(int pin, int, int){return attach(pin);}
+	void    detach(){m_pin = -1;}
+	bool    attached() const {return m_pin >= 0;}
+
+	void write(int value) // Angle in degrees, or pulse width if large enough
+	{
+		if (value < MIN_PULSE_WIDTH)
+			value = map(constrain(value, 0, 180), 0, 180, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);
+		writeMicroseconds(value);
+	}
+	void writeMicroseconds(int value){m_pulseWidth = constrain(value, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);}
+
+	int read() const {return map(m_pulseWidth + 1, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH, 0, 180);}
+	int readMicroseconds() const {return m_pulseWidth;}
+
+private:
+
+	int m_pin;
+	int m_pulseWidth;
+};
+
+#endif // __SERVO_H__
@@ -0,0 +1,6 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <Arduino.h> // Print and Stream are declared there
+
+#endif // __STREAM_H__
@@ -0,0 +1,12 @@
+#ifndef __INTERRUPT_H__
+#define __INTERRUPT_H__
+
+// The host has no interrupt vectors: interrupts are simulated by HostPins and ISR() bodies are
+// plain functions that nothing calls.
+
+#define cli() noInterrupts()
+#define sei() interrupts()
+
+#define ISR(vector, ...) extern "C" void vector(void)
+
+#endif // __INTERRUPT_H__
@@ -0,0 +1,127 @@
+// Entry point of the sketches built for the host: it calls setup() then loop() as the Arduino core
+// does, and bridges Serial to a pseudo-terminal so that the Raspberry Pi code can talk to it as
+// to a real board.
+//
+// Usage: <sketch> [--pty | --stdio] [--eeprom FILE] [--loops N] [--timestep US]
+//
+//   --pty          open a pseudo-terminal, print its name and connect Serial to it
+//   --stdio        connect Serial to the standard input and output instead
+//   --eeprom FILE  back the EEPROM with FILE, so that it persists across runs
+//   --loops N      return after N calls to loop() (it runs forever by default)
+//   --timestep US  use the virtual clock and advance it by US microseconds after each loop()
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+static int openPseudoTerminal()
+{
+	int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0)
+		return -1;
+	termios tty;
+	tcgetattr(fd, &tty);
+	cfmakeraw(&tty);
+	tcsetattr(fd, TCSANOW, &tty);
+	return fd;
+}
+
+static void exchange(int inFd, int outFd, LoopbackStream& link)
+{
+	uint8_t buffer[256];
+	ssize_t count;
+	pollfd input = {inFd, POLLIN, 0};
+	while (poll(&input, 1, 0) > 0 && (input.revents & POLLIN) && (count = read(inFd, buffer, sizeof(buffer))) > 0)
+		link.write(buffer, count);
+	while (link.available() > 0)
+	{
+		size_t size = 0;
+		while (size < sizeof(buffer) && link.available() > 0)
+			buffer[size++] = link.read();
+		for (size_t offset = 0; offset < size;)
+		{
+			// The bytes are lost if no one reads them, as on a real serial line
+			pollfd output = {outFd, POLLOUT, 0};
+			if (poll(&output, 1, 10) <= 0 || (count = write(outFd, buffer + offset, size - offset)) <= 0)
+				break;
+			offset += count;
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool          pty      = false;
+	bool          stdio    = false;
+	unsigned long loops    = 0;
+	unsigned long timestep = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--pty") == 0)
+			pty = true;
+		else if (strcmp(argv[i], "--stdio") == 0)
+			stdio = true;
+		else if (strcmp(argv[i], "--eeprom") == 0 && i + 1 < argc)
+		{
+			if (!HostEEPROM::open(argv[++i]))
+			{
+				perror(argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc)
+			loops = strtoul(argv[++i], 0, 0);
+		else if (strcmp(argv[i], "--timestep") == 0 && i + 1 < argc)
+		{
+			timestep = strtoul(argv[++i], 0, 0);
+			HostClock::useVirtualTime();
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--pty | --stdio] [--eeprom FILE] [--loops N] [--timestep US]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	int inFd = -1, outFd = -1;
+	LoopbackStream link;
+	if (pty)
+	{
+		inFd = outFd = openPseudoTerminal();
+		if (inFd < 0)
+		{
+			perror("posix_openpt");
+			return 1;
+		}
+		printf("%s\n", ptsname(inFd));
+		fflush(stdout);
+		Serial.connect(link);
+	}
+	else if (stdio)
+	{
+		inFd  = STDIN_FILENO;
+		outFd = STDOUT_FILENO;
+		Serial.connect(link);
+	}
+
+	setup();
+	for (unsigned long i = 0; loops == 0 || i < loops; i++)
+	{
+		if (inFd >= 0)
+			exchange(inFd, outFd, link);
+		loop();
+		if (inFd >= 0)
+			exchange(inFd, outFd, link);
+		if (timestep > 0)
+			HostClock::advanceMicros(timestep);
+	}
+	HostEEPROM::close();
+	return 0;
+}
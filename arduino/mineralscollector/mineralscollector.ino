@@ -32,24 +32,30 @@ bool validPress = true;
 
 EndStop button; 
 
+constexpr SerialTalks::Binding instructions[] PROGMEM =
+{
+  {_SET_ROLLER_VELOCITY_OPCODE,         SET_ROLLER_VELOCITY},
+  {_SET_FIRING_HAMMER_VELOCITY_OPCODE,  SET_FIRING_HAMMER_VELOCITY},
+  {_RETURN_TO_SAFE_POSITION_OPCODE,     RETURN_TO_SAFE_POSITION},
+  {_SETUP_AX_OPCODE,                    SETUP_AX},
+  {_SET_AX_POSITION_OPCODE,             SET_AX_POSITION},
+  {_GET_AX_TORQUE_OPCODE,               GET_AX_TORQUE},
+  {_SET_AX_VELOCITY_MOVE_OPCODE,        SET_AX_VELOCITY_MOVE},
+  {_PING_AX_OPCODE,                     PING_AX},
+  {_SET_AX_HOLD_OPCODE,                 SET_AX_HOLD},
+  {_GET_AX_POSITION_OPCODE,             GET_AX_POSITION},
+  {AX12_SEND_INSTRUCTION_PACKET_OPCODE, AX12_SEND_INSTRUCTION_PACKET},
+  {AX12_RECEIVE_STATUS_PACKET_OPCODE,   AX12_RECEIVE_STATUS_PACKET},
+  {_GET_AX_VELOCITY_OPCODE,             GET_AX_VELOCITY},
+  {_GET_AX_MOVING_OPCODE,               GET_AX_MOVING},
+  {LAUNCHPAD_SET_POSITION_OPCODE,       LAUNCHPAD_SET_POSITION},
+};
+static_assert(SerialTalks::checkBindings(instructions), "instructions opcodes must be unique and not reserved");
+
 void setup(){
   Serial.begin(SERIALTALKS_BAUDRATE);
   talks.begin(Serial);
-  talks.bind(_SET_ROLLER_VELOCITY_OPCODE, SET_ROLLER_VELOCITY);
-  talks.bind(_SET_FIRING_HAMMER_VELOCITY_OPCODE,  SET_FIRING_HAMMER_VELOCITY);
-  talks.bind(_RETURN_TO_SAFE_POSITION_OPCODE, RETURN_TO_SAFE_POSITION);
-  talks.bind(_SETUP_AX_OPCODE, SETUP_AX);
-  talks.bind(_SET_AX_POSITION_OPCODE, SET_AX_POSITION);
-  talks.bind(_GET_AX_TORQUE_OPCODE, GET_AX_TORQUE);
-  talks.bind(_SET_AX_VELOCITY_MOVE_OPCODE,  SET_AX_VELOCITY_MOVE);
-  talks.bind(_PING_AX_OPCODE, PING_AX);
-  talks.bind(_SET_AX_HOLD_OPCODE, SET_AX_HOLD);
-  talks.bind(_GET_AX_POSITION_OPCODE, GET_AX_POSITION);
-  talks.bind(AX12_SEND_INSTRUCTION_PACKET_OPCODE, AX12_SEND_INSTRUCTION_PACKET);
-  talks.bind(AX12_RECEIVE_STATUS_PACKET_OPCODE, AX12_RECEIVE_STATUS_PACKET);
-  talks.bind(_GET_AX_VELOCITY_OPCODE, GET_AX_VELOCITY);
-  talks.bind(_GET_AX_MOVING_OPCODE, GET_AX_MOVING);
-  talks.bind(LAUNCHPAD_SET_POSITION_OPCODE, LAUNCHPAD_SET_POSITION);
+  talks.bind(instructions);
 
   AX12::SerialBegin(9600, RX, TX, DATA_CONTROL);
 
@@ -76,7 +82,7 @@ void setup(){
 }
 
 void loop(){
-  talks.execute();
+  talks.execute(1000); // us, so that the hammer keeps on being watched
   safeHammer.update();
 
   if(button.getState() && validPress && !launchingPosition && tps.getElapsedTime() >= 0.5){
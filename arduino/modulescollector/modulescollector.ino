@@ -27,19 +27,25 @@ Clock movingTime;
 bool elevatorMoving = false;
 bool motorError = false;
 
+constexpr SerialTalks::Binding instructions[] PROGMEM =
+{
+    {_WRITE_DISPENSER_OPCODE,    WRITE_DISPENSER},
+    {_WRITE_GRIP_OPCODE,         WRITE_GRIP},
+    {_IS_UP_OPCODE,              IS_UP},
+    {_IS_DOWN_OPCODE,            IS_DOWN},
+    {_SET_MOTOR_VELOCITY_OPCODE, SET_MOTOR_VELOCITY},
+    {_OPEN_GRIP_OPCODE,          OPEN_GRIP},
+    {_SET_GRIP_VELOCITY_OPCODE,  SET_GRIP_VELOCITY},
+    {_GET_MOTOR_VELOCITY_OPCODE, GET_MOTOR_VELOCITY},
+    {_GET_LEFT_MUSTACHE_OPCODE,  GET_LEFT_MUSTACHE},
+    {_GET_RIGHT_MUSTACHE_OPCODE, GET_RIGHT_MUSTACHE},
+};
+static_assert(SerialTalks::checkBindings(instructions), "instructions opcodes must be unique and not reserved");
+
 void setup(){
     Serial.begin(SERIALTALKS_BAUDRATE);
     talks.begin(Serial);
-    talks.bind(_WRITE_DISPENSER_OPCODE, WRITE_DISPENSER);
-    talks.bind(_WRITE_GRIP_OPCODE, WRITE_GRIP);
-    talks.bind(_IS_UP_OPCODE, IS_UP);
-    talks.bind(_IS_DOWN_OPCODE, IS_DOWN);
-    talks.bind(_SET_MOTOR_VELOCITY_OPCODE, SET_MOTOR_VELOCITY);
-    talks.bind(_OPEN_GRIP_OPCODE, OPEN_GRIP);   
-    talks.bind(_SET_GRIP_VELOCITY_OPCODE, SET_GRIP_VELOCITY);
-    talks.bind(_GET_MOTOR_VELOCITY_OPCODE,GET_MOTOR_VELOCITY);
-    talks.bind(_GET_LEFT_MUSTACHE_OPCODE, GET_LEFT_MUSTACHE);
-    talks.bind(_GET_RIGHT_MUSTACHE_OPCODE, GET_RIGHT_MUSTACHE);
+    talks.bind(instructions);
 
     pinMode(SERVO2, OUTPUT);
     dispenser.attach(SERVO2);
@@ -70,7 +76,7 @@ void setup(){
 }
 
 void loop(){
-     talks.execute();
+     talks.execute(1000); // us, so that the end stops keep on being watched
      gripper.update();
      dispenser.update();
 
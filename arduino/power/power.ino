@@ -8,13 +8,19 @@ int percentage = 0;
 
 void getVoltage();
 
+constexpr SerialTalks::Binding instructions[] PROGMEM =
+{
+    {_GET_EMERGENCY_STOP_STATE_OPCODE, GET_EMERGENCY_STOP_STATE},
+    {_GET_VOLTAGE_OPCODE,              GET_VOLTAGE},
+    {_GET_BATTERY_CHARGE_OPCODE,       GET_BATTERY_CHARGE},
+};
+static_assert(SerialTalks::checkBindings(instructions), "instructions opcodes must be unique and not reserved");
+
 void setup(){
     Serial.begin(SERIALTALKS_BAUDRATE);
     talks.begin(Serial);
 
-    talks.bind(_GET_EMERGENCY_STOP_STATE_OPCODE, GET_EMERGENCY_STOP_STATE);
-    talks.bind(_GET_VOLTAGE_OPCODE, GET_VOLTAGE);
-    talks.bind(_GET_BATTERY_CHARGE_OPCODE, GET_BATTERY_CHARGE);
+    talks.bind(instructions);
 
 	pinMode(CURRENT_PIN,INPUT);
 	pinMode(VOLTAGE_PIN,INPUT);
@@ -11,10 +11,16 @@ bool activated = true;
 UltrasonicSensor SensorAv;
 UltrasonicSensor SensorAr;
 
+constexpr SerialTalks::Binding instructions[] PROGMEM =
+{
+    {GET_MESURE_OPCODE, GET_MESURE},
+};
+static_assert(SerialTalks::checkBindings(instructions), "instructions opcodes must be unique and not reserved");
+
 void setup() {
     Serial.begin(SERIALTALKS_BAUDRATE);
     talks.begin(Serial);
-    talks.bind(GET_MESURE_OPCODE, GET_MESURE);
+    talks.bind(instructions);
     SensorAv.attach(TRIGGPIN7, ECHOPIN2);
     SensorAr.attach(TRIGGPIN8, ECHOPIN3);
     SensorAv.trig();
@@ -0,0 +1,101 @@
+#include <Arduino.h>
+
+#include "DifferentialDriveModel.h"
+#include "constants.h"
+
+
+void SimulatedMotor::update()
+{
+	if (m_enabled && m_velocity != 0)
+	{
+		int PWM = m_velocity / (2 * M_PI * m_wheelRadius) * m_constant * 255;
+		if (PWM <   0) PWM *= -1;
+		if (PWM > 255 * m_maxPWM) PWM = 255 * m_maxPWM;
+		m_PWM = (m_velocity * m_constant * m_wheelRadius > 0) ? PWM : -PWM;
+	}
+	else
+	{
+		m_PWM = 0;
+	}
+}
+
+float SimulatedMotor::getMaxVelocity() const
+{
+	return abs((2 * M_PI * m_wheelRadius) / m_constant) * m_maxPWM;
+}
+
+float SimulatedCodewheel::getTraveledDistance()
+{
+	return (float)(m_counter - m_startCounter) / m_countsPerRev * (2.0 * M_PI * m_wheelRadius);
+}
+
+float SimulatedCodewheel::restart()
+{
+	float distance = getTraveledDistance();
+	m_startCounter = m_counter;
+	return distance;
+}
+
+DifferentialDriveModel::Parameters::Parameters() :
+	leftWheelRadius(LEFT_WHEEL_RADIUS),
+	rightWheelRadius(RIGHT_WHEEL_RADIUS),
+	wheelsAxleTrack(WHEELS_AXLE_TRACK),
+	motorsConstant(60.0 * DCMOTORS_REDUCTION_RATIO / DCMOTORS_VELOCITY_CONSTANT / DCMOTORS_SUPPLIED_VOLTAGE),
+	leftCodewheelRadius(LEFT_CODEWHEEL_RADIUS),
+	rightCodewheelRadius(RIGHT_CODEWHEEL_RADIUS),
+	codewheelsAxleTrack(CODEWHEELS_AXLE_TRACK),
+	codewheelsCountsPerRev(CODEWHEELS_COUNTS_PER_REVOLUTION),
+	linearTimeConstant(BODY_LINEAR_TIME_CONSTANT),
+	angularTimeConstant(BODY_ANGULAR_TIME_CONSTANT),
+	maxAcceleration(WHEELS_MAX_ACCELERATION),
+	codewheelsSlip(CODEWHEELS_SLIP)
+{}
+
+float DifferentialDriveModel::getWheelVelocity(const SimulatedMotor& motor, float wheelRadius) const
+{
+	// Steady-state velocity of an unloaded wheel for the given duty cycle
+	return motor.getDutyCycle() * (2 * M_PI * wheelRadius) / m_params.motorsConstant;
+}
+
+void DifferentialDriveModel::step(float timestep)
+{
+	// The body velocities follow the ones the wheels impose with a first order response
+	const float leftWheelVel  = getWheelVelocity(*m_leftMotor,  m_params.leftWheelRadius);
+	const float rightWheelVel = getWheelVelocity(*m_rightMotor, m_params.rightWheelRadius);
+	const float linVelTarget  = (leftWheelVel + rightWheelVel) / 2;
+	const float angVelTarget  = (rightWheelVel - leftWheelVel) / m_params.wheelsAxleTrack;
+
+	float linAcc = (linVelTarget - m_linVel) / m_params.linearTimeConstant;
+	float angAcc = (angVelTarget - m_angVel) / m_params.angularTimeConstant;
+
+	// But the floor can't transmit more than a given force: beyond that the wheels slip and the
+	// body accelerates no more
+	const float leftWheelAcc  = linAcc - angAcc * m_params.wheelsAxleTrack / 2;
+	const float rightWheelAcc = linAcc + angAcc * m_params.wheelsAxleTrack / 2;
+	const float maxWheelAcc = max(abs(leftWheelAcc), abs(rightWheelAcc));
+	m_slipping = maxWheelAcc > m_params.maxAcceleration;
+	if (m_slipping)
+	{
+		linAcc *= m_params.maxAcceleration / maxWheelAcc;
+		angAcc *= m_params.maxAcceleration / maxWheelAcc;
+	}
+	m_linVel += linAcc * timestep;
+	m_angVel += angAcc * timestep;
+
+	// Integrate the true position
+	const float deltaLinPos = m_linVel * timestep;
+	const float deltaAngPos = m_angVel * timestep;
+	const float avgTheta = m_pos.theta + deltaAngPos / 2;
+	m_pos.x     += deltaLinPos * cos(avgTheta);
+	m_pos.y     += deltaLinPos * sin(avgTheta);
+	m_pos.theta += deltaAngPos;
+
+	// The codewheels roll with the body and their counters are quantized
+	const float codewheelsRatio = 1 - m_params.codewheelsSlip;
+	m_leftCodewheelDistance  += (deltaLinPos - deltaAngPos * m_params.codewheelsAxleTrack / 2) * codewheelsRatio;
+	m_rightCodewheelDistance += (deltaLinPos + deltaAngPos * m_params.codewheelsAxleTrack / 2) * codewheelsRatio;
+	if (m_leftCodewheel != 0)
+		m_leftCodewheel->m_counter = floor(m_leftCodewheelDistance / (2 * M_PI * m_params.leftCodewheelRadius) * m_params.codewheelsCountsPerRev);
+	if (m_rightCodewheel != 0)
+		m_rightCodewheel->m_counter = floor(m_rightCodewheelDistance / (2 * M_PI * m_params.rightCodewheelRadius) * m_params.codewheelsCountsPerRev);
+}
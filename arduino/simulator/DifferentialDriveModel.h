@@ -0,0 +1,143 @@
+#ifndef __DIFFERENTIALDRIVEMODEL_H__
+#define __DIFFERENTIALDRIVEMODEL_H__
+
+#include "../common/NonCopyable.h"
+#include "../common/DifferentialController.h"
+#include "../common/Odometry.h"
+
+#include <math.h>
+
+
+// Physics model of a differential drive robot: two DC motors drive the wheels, the robot body
+// follows them with some inertia and two passive codewheels measure its displacements.
+//
+// The model only knows the true mechanical constants. The simulated motors and codewheels have
+// their own settings, as the real DCMotor and Codewheel have, so that calibration errors can be
+// reproduced.
+
+class DifferentialDriveModel;
+
+class SimulatedMotor : private NonCopyable, public AbstractMotor
+{
+public:
+
+	SimulatedMotor() : m_enabled(true), m_velocity(0), m_wheelRadius(1 / (2 * M_PI)), m_constant(1), m_maxPWM(1), m_PWM(0){}
+
+	virtual void  setVelocity(float velocity){m_velocity = velocity; update();}
+	virtual float getMaxVelocity() const;
+
+	void setConstant   (float constant)   {m_constant    = constant;    update();}
+	void setWheelRadius(float wheelRadius){m_wheelRadius = wheelRadius; update();}
+	void setMaxPWM     (float maxPWM)     {m_maxPWM      = maxPWM;      update();}
+
+	void enable (){m_enabled = true;  update();}
+	void disable(){m_enabled = false; update();}
+
+	float getVelocity() const {return m_velocity;}
+
+	// Signed duty cycle in [-1, 1], quantized as analogWrite does
+	float getDutyCycle() const {return m_PWM / 255.0f;}
+
+protected:
+
+	void update(); // Same computation as DCMotor::update
+
+	bool  m_enabled;
+	float m_velocity; // in mm/s
+	float m_wheelRadius; // in mm
+	float m_constant; // (60 * reduction_ratio / velocity_constant_in_RPM) / supplied_voltage_in_V
+	float m_maxPWM; // in range ]0, 1]
+
+	int m_PWM; // in range [-255, 255]
+};
+
+class SimulatedCodewheel : private NonCopyable, public AbstractCodewheel
+{
+public:
+
+	SimulatedCodewheel() : m_counter(0), m_startCounter(0), m_wheelRadius(1 / (2 * M_PI)), m_countsPerRev(1000){}
+
+	long getCounter() const {return m_counter;}
+
+	void setCountsPerRev(long countsPerRev){m_countsPerRev = countsPerRev;}
+	void setWheelRadius (float wheelRadius){m_wheelRadius  = wheelRadius;}
+
+	virtual float getTraveledDistance();
+	virtual float restart();
+
+protected:
+
+	friend class DifferentialDriveModel;
+
+	long m_counter; // set by the model
+	long m_startCounter;
+
+	float m_wheelRadius; // in mm
+	long  m_countsPerRev;
+};
+
+class DifferentialDriveModel
+{
+public:
+
+	struct Parameters
+	{
+		Parameters();
+
+		float leftWheelRadius; // in mm
+		float rightWheelRadius; // in mm
+		float wheelsAxleTrack; // in mm
+		float motorsConstant; // see SimulatedMotor
+
+		float leftCodewheelRadius; // in mm
+		float rightCodewheelRadius; // in mm
+		float codewheelsAxleTrack; // in mm
+		long  codewheelsCountsPerRev;
+
+		float linearTimeConstant; // in s, the body response to the wheels (mass)
+		float angularTimeConstant; // in s, the body response to the wheels (moment of inertia)
+		float maxAcceleration; // in mm/s^2, beyond which the wheels slip on the floor
+		float codewheelsSlip; // fraction of the traveled distance that the codewheels miss
+	};
+
+	DifferentialDriveModel() : m_leftMotor(0), m_rightMotor(0), m_leftCodewheel(0), m_rightCodewheel(0), m_linVel(0), m_angVel(0), m_slipping(false), m_leftCodewheelDistance(0), m_rightCodewheelDistance(0){}
+
+	void setParameters(const Parameters& parameters){m_params = parameters;}
+	const Parameters& getParameters() const {return m_params;}
+
+	void setMotors(const SimulatedMotor& leftMotor, const SimulatedMotor& rightMotor){m_leftMotor = &leftMotor; m_rightMotor = &rightMotor;}
+	void setCodewheels(SimulatedCodewheel& leftCodewheel, SimulatedCodewheel& rightCodewheel){m_leftCodewheel = &leftCodewheel; m_rightCodewheel = &rightCodewheel;}
+
+	void setPosition(const Position& pos){m_pos = pos; m_linVel = m_angVel = 0;}
+
+	// Move the robot by `timestep` seconds according to the motors commands
+	void step(float timestep);
+
+	const Position& getPosition() const {return m_pos;}
+
+	float getLinVel() const {return m_linVel;}
+	float getAngVel() const {return m_angVel;}
+
+	bool isSlipping() const {return m_slipping;}
+
+protected:
+
+	float getWheelVelocity(const SimulatedMotor& motor, float wheelRadius) const;
+
+	Parameters m_params;
+
+	const SimulatedMotor* m_leftMotor;
+	const SimulatedMotor* m_rightMotor;
+	SimulatedCodewheel*   m_leftCodewheel;
+	SimulatedCodewheel*   m_rightCodewheel;
+
+	Position m_pos; // true position
+	float    m_linVel; // in mm/s
+	float    m_angVel; // in rad/s
+	bool     m_slipping;
+
+	double m_leftCodewheelDistance; // in mm, not quantized
+	double m_rightCodewheelDistance; // in mm, not quantized
+};
+
+#endif // __DIFFERENTIALDRIVEMODEL_H__
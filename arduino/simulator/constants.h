@@ -0,0 +1,37 @@
+#ifndef __SIMULATOR_CONSTANTS_H__
+#define __SIMULATOR_CONSTANTS_H__
+
+#include "../wheeledbase/constants.h"
+
+// Dynamics constants (rough estimates, to be refined against logs of the real robot)
+
+#define BODY_LINEAR_TIME_CONSTANT  80e-3 // s
+#define BODY_ANGULAR_TIME_CONSTANT 60e-3 // s
+#define WHEELS_MAX_ACCELERATION     5000 // mm/s^2, about half the gravity on a painted wooden floor
+#define CODEWHEELS_SLIP                0 // ratio
+
+// Control tunings, in place of the ones the board reads from its EEPROM
+
+#define LINVELPID_KP   1.5
+#define LINVELPID_KI  15.0
+#define LINVELPID_KD   0.0
+#define ANGVELPID_KP   1.5
+#define ANGVELPID_KI  15.0
+#define ANGVELPID_KD   0.0
+
+#define POSITIONCONTROL_LINVELKP 2.0 // s^-1
+#define POSITIONCONTROL_ANGVELKP 4.0 // s^-1
+
+#define PUREPURSUIT_LOOKAHEAD    150 // mm
+#define PUREPURSUIT_LOOKAHEADBIS  50 // mm
+#define PUREPURSUIT_LOOKAHEADMAX   0 // mm, constant look-ahead
+#define PUREPURSUIT_LOOKAHEADGAIN  0 // s
+#define PUREPURSUIT_MAXLATACC      0 // mm/s^2, no velocity profile
+#define PUREPURSUIT_CORNERRADIUS   0 // mm, sharp corners
+
+// Simulation
+
+#define SIMULATION_TIMESTEP 100e-6 // s, about the duration of a wheeledbase loop
+#define STREAMING_PERIOD     50000 // us, the period of the host subscription to PUREPURSUIT_LOW_WATERMARK
+
+#endif // __SIMULATOR_CONSTANTS_H__
@@ -0,0 +1,532 @@
+// Closed-loop simulation of the wheeledbase: the real odometry, velocity control, position control
+// and PurePursuit code drive a physics model of the robot (see DifferentialDriveModel.h) on the
+// virtual clock, as fast as the host can.
+//
+// Usage: simulator [options] x0,y0 x1,y1 ...
+//
+// Each item after the first one goes to `x,y` along a straight line, along an arc with `x,y,radius`
+// (positive to turn left) or along a cubic Bezier curve with `x1,y1,x2,y2,x,y`.
+//
+//   --path FILE        read the items from FILE, one per line
+//   --backward         follow the path backward
+//   --final-angle RAD  angle of the last segment by default
+//   --set NAME=VALUE   override a tuning or a model parameter (run with --list to see them)
+//   --stream N         stream the path as the host would, whenever no more than N waypoints are
+//                      left ahead (for paths longer than PUREPURSUIT_MAX_WAYPOINTS)
+//   --timeout S        give up after S simulated seconds (60 by default)
+//   --csv FILE         write the true and estimated positions every 10 ms to FILE
+//
+// It prints a summary of the run and returns 0 if the robot reached the end of the path.
+
+#include <Arduino.h>
+
+#include "constants.h"
+#include "DifferentialDriveModel.h"
+
+#include "../common/Scheduler.h"
+#include "../common/Odometry.h"
+#include "../common/PID.h"
+#include "../common/VelocityController.h"
+#include "../common/PositionController.h"
+#include "../common/PurePursuit.h"
+#include "../common/mathutils.h"
+
+#include <chrono>
+#include <vector>
+
+// Modules, wired as in wheeledbase.ino
+
+SimulatedMotor leftWheel;
+SimulatedMotor rightWheel;
+
+SimulatedCodewheel leftCodewheel;
+SimulatedCodewheel rightCodewheel;
+
+Odometry odometry;
+
+VelocityController velocityControl;
+
+PID linVelPID;
+PID angVelPID;
+
+PositionController positionControl;
+
+PurePursuit purePursuit;
+
+DifferentialDriveModel robot;
+
+static void velocityControlInputs()
+{
+	velocityControl.setInputs(odometry.getLinVel(), odometry.getAngVel());
+}
+
+static void positionControlInputs()
+{
+	positionControl.setPosInput(odometry.getPosition());
+	positionControl.setVelInput(odometry.getLinVel(), odometry.getAngVel());
+}
+
+static void positionControlOutputs()
+{
+	velocityControl.setSetpoints(positionControl.getLinVelSetpoint(), positionControl.getAngVelSetpoint());
+}
+
+// Settings
+
+struct Settings
+{
+	DifferentialDriveModel::Parameters model;
+
+	float linVelPIDKp = LINVELPID_KP, linVelPIDKi = LINVELPID_KI, linVelPIDKd = LINVELPID_KD;
+	float angVelPIDKp = ANGVELPID_KP, angVelPIDKi = ANGVELPID_KI, angVelPIDKd = ANGVELPID_KD;
+	float maxLinAcc = MAX_LINEAR_ACCELERATION, maxLinDec = MAX_LINEAR_DECCELERATION;
+	float maxAngAcc = MAX_ANGULAR_ACCELERATION, maxAngDec = MAX_ANGULAR_DECCELERATION;
+
+	float linVelKp = POSITIONCONTROL_LINVELKP, angVelKp = POSITIONCONTROL_ANGVELKP;
+	float linVelMax = MAX_LINEAR_VELOCITY, angVelMax = MAX_ANGULAR_VELOCITY;
+	float linPosThreshold = MIN_LINEAR_POSITION, angPosThreshold = MIN_ANGULAR_POSITION;
+	float lookAhead = PUREPURSUIT_LOOKAHEAD, lookAheadBis = PUREPURSUIT_LOOKAHEADBIS;
+	float lookAheadMax = PUREPURSUIT_LOOKAHEADMAX, lookAheadGain = PUREPURSUIT_LOOKAHEADGAIN;
+	float maxLatAcc = PUREPURSUIT_MAXLATACC;
+	float cornerRadius = PUREPURSUIT_CORNERRADIUS;
+
+	// What the board believes, which may differ from the model
+	float leftWheelRadius = LEFT_WHEEL_RADIUS, rightWheelRadius = RIGHT_WHEEL_RADIUS;
+	float leftCodewheelRadius = LEFT_CODEWHEEL_RADIUS, rightCodewheelRadius = RIGHT_CODEWHEEL_RADIUS;
+	float codewheelsAxleTrack = CODEWHEELS_AXLE_TRACK;
+};
+
+static Settings settings;
+
+static const struct {const char* name; float* value;} s_parameters[] =
+{
+	{"linvelpid.kp",           &settings.linVelPIDKp},
+	{"linvelpid.ki",           &settings.linVelPIDKi},
+	{"linvelpid.kd",           &settings.linVelPIDKd},
+	{"angvelpid.kp",           &settings.angVelPIDKp},
+	{"angvelpid.ki",           &settings.angVelPIDKi},
+	{"angvelpid.kd",           &settings.angVelPIDKd},
+	{"velocitycontrol.maxlinacc", &settings.maxLinAcc},
+	{"velocitycontrol.maxlindec", &settings.maxLinDec},
+	{"velocitycontrol.maxangacc", &settings.maxAngAcc},
+	{"velocitycontrol.maxangdec", &settings.maxAngDec},
+	{"positioncontrol.linvelkp",  &settings.linVelKp},
+	{"positioncontrol.angvelkp",  &settings.angVelKp},
+	{"positioncontrol.linvelmax", &settings.linVelMax},
+	{"positioncontrol.angvelmax", &settings.angVelMax},
+	{"positioncontrol.linposthreshold", &settings.linPosThreshold},
+	{"positioncontrol.angposthreshold", &settings.angPosThreshold},
+	{"purepursuit.lookahead",     &settings.lookAhead},
+	{"purepursuit.lookaheadbis",  &settings.lookAheadBis},
+	{"purepursuit.lookaheadmax",  &settings.lookAheadMax},
+	{"purepursuit.lookaheadgain", &settings.lookAheadGain},
+	{"purepursuit.maxlatacc",     &settings.maxLatAcc},
+	{"purepursuit.cornerradius",  &settings.cornerRadius},
+	{"leftwheel.radius",          &settings.leftWheelRadius},
+	{"rightwheel.radius",         &settings.rightWheelRadius},
+	{"leftcodewheel.radius",      &settings.leftCodewheelRadius},
+	{"rightcodewheel.radius",     &settings.rightCodewheelRadius},
+	{"odometry.axletrack",        &settings.codewheelsAxleTrack},
+	{"model.leftwheelradius",     &settings.model.leftWheelRadius},
+	{"model.rightwheelradius",    &settings.model.rightWheelRadius},
+	{"model.wheelsaxletrack",     &settings.model.wheelsAxleTrack},
+	{"model.motorsconstant",      &settings.model.motorsConstant},
+	{"model.leftcodewheelradius", &settings.model.leftCodewheelRadius},
+	{"model.rightcodewheelradius",&settings.model.rightCodewheelRadius},
+	{"model.codewheelsaxletrack", &settings.model.codewheelsAxleTrack},
+	{"model.lineartimeconstant",  &settings.model.linearTimeConstant},
+	{"model.angulartimeconstant", &settings.model.angularTimeConstant},
+	{"model.maxacceleration",     &settings.model.maxAcceleration},
+	{"model.codewheelsslip",      &settings.model.codewheelsSlip},
+};
+
+static bool setParameter(const char* assignment)
+{
+	const char* equal = strchr(assignment, '=');
+	if (equal == 0)
+		return false;
+	for (size_t i = 0; i < sizeof(s_parameters) / sizeof(s_parameters[0]); i++)
+	{
+		if (strncmp(s_parameters[i].name, assignment, equal - assignment) == 0 && s_parameters[i].name[equal - assignment] == '\0')
+		{
+			*s_parameters[i].value = atof(equal + 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Streaming, as the host does when subscribed to PUREPURSUIT_LOW_WATERMARK
+
+struct PathItem
+{
+	PathItem(const PurePursuit::Waypoint& end, float radius = 0) : end(end), radius(radius), bezier(false){}
+	PathItem(const PurePursuit::Waypoint& control1, const PurePursuit::Waypoint& control2, const PurePursuit::Waypoint& end) : control1(control1), control2(control2), end(end), radius(0), bezier(true){}
+
+	PurePursuit::Waypoint control1, control2, end;
+	float radius;
+	bool bezier;
+
+	int getNumWaypoints() const {return bezier ? PUREPURSUIT_BEZIER_ARCS : 1;}
+};
+
+static std::vector<PathItem> s_path;
+static size_t s_numSent = 0;
+static float s_finalAngle;
+
+static bool addPathItem(const PathItem& item)
+{
+	// Same as the ADD_PUREPURSUIT_WAYPOINT, ADD_PUREPURSUIT_ARC and ADD_PUREPURSUIT_BEZIER
+	// instructions
+	if (item.bezier)
+		return purePursuit.addBezier(item.control1, item.control2, item.end);
+	return purePursuit.addArc(item.end, item.radius);
+}
+
+static float getStartAngle(const PurePursuit::Waypoint& start, const PathItem& item)
+{
+	// Same start tangents as PurePursuit::addArc and PurePursuit::addBezier
+	if (item.bezier)
+	{
+		const bool atStart1 = item.control1.x == start.x && item.control1.y == start.y;
+		const bool atStart2 = item.control2.x == start.x && item.control2.y == start.y;
+		const PurePursuit::Waypoint& toward = !atStart1 ? item.control1 : !atStart2 ? item.control2 : item.end;
+		return atan2(toward.y - start.y, toward.x - start.x);
+	}
+	const float chordAngle = atan2(item.end.y - start.y, item.end.x - start.x);
+	const float chord = hypot(item.end.x - start.x, item.end.y - start.y);
+	if (item.radius == 0 || chord <= 0)
+		return chordAngle;
+	const float halfAngle = asin(min(chord / (2 * abs(item.radius)), 1.0f));
+	return chordAngle - ((item.radius > 0) ? halfAngle : -halfAngle);
+}
+
+static void setPosSetpoint(PurePursuit::Direction direction)
+{
+	const PurePursuit::Waypoint& end = s_path.back().end;
+	positionControl.setPosSetpoint(Position(end.x, end.y, purePursuit.getEndAngle() + (direction == PurePursuit::BACKWARD ? M_PI : 0)));
+}
+
+static void setFinalAngle()
+{
+	purePursuit.setFinalAngle(isnan(s_finalAngle) ? purePursuit.getEndAngle() : s_finalAngle);
+}
+
+static void streamWaypoints()
+{
+	if (!purePursuit.isBelowLowWatermark())
+		return;
+	int numFree = purePursuit.getNumFreeWaypoints();
+	while (s_numSent < s_path.size() && s_path[s_numSent].getNumWaypoints() <= numFree && addPathItem(s_path[s_numSent]))
+		numFree -= s_path[s_numSent++].getNumWaypoints();
+	if (s_numSent == s_path.size())
+	{
+		// Same as the END_PUREPURSUIT_PATH instruction
+		setFinalAngle();
+		purePursuit.setPathOpen(false);
+		setPosSetpoint(purePursuit.getDirection());
+	}
+}
+
+// Setup, as in wheeledbase.ino but with the settings instead of the EEPROM content
+
+static void setup(PurePursuit::Direction direction, int lowWatermark)
+{
+	const std::vector<PathItem>& path = s_path;
+
+	leftWheel .setConstant(settings.model.motorsConstant);
+	rightWheel.setConstant(settings.model.motorsConstant);
+	leftWheel .setWheelRadius(settings.leftWheelRadius);
+	rightWheel.setWheelRadius(settings.rightWheelRadius);
+
+	leftCodewheel .setWheelRadius(settings.leftCodewheelRadius);
+	rightCodewheel.setWheelRadius(settings.rightCodewheelRadius);
+	leftCodewheel .setCountsPerRev(CODEWHEELS_COUNTS_PER_REVOLUTION);
+	rightCodewheel.setCountsPerRev(CODEWHEELS_COUNTS_PER_REVOLUTION);
+
+	robot.setParameters(settings.model);
+	robot.setMotors(leftWheel, rightWheel);
+	robot.setCodewheels(leftCodewheel, rightCodewheel);
+
+	odometry.setAxleTrack(settings.codewheelsAxleTrack);
+	odometry.setSlippage(0);
+	odometry.setCodewheels(leftCodewheel, rightCodewheel);
+	odometry.setTimestep(ODOMETRY_TIMESTEP);
+	odometry.enable();
+
+	velocityControl.setAxleTrack(WHEELS_AXLE_TRACK);
+	velocityControl.setMaxAcc(settings.maxLinAcc, settings.maxAngAcc);
+	velocityControl.setMaxDec(settings.maxLinDec, settings.maxAngDec);
+	velocityControl.setSpinShutdown(true);
+	velocityControl.setWheels(leftWheel, rightWheel);
+	velocityControl.setPID(linVelPID, angVelPID);
+	velocityControl.setTimestep(PID_CONTROLLERS_TIMESTEP);
+
+	const float maxLinVel = min(leftWheel.getMaxVelocity(), rightWheel.getMaxVelocity());
+	const float maxAngVel = min(leftWheel.getMaxVelocity(), rightWheel.getMaxVelocity()) * 2 / WHEELS_AXLE_TRACK;
+	linVelPID.setTunings(settings.linVelPIDKp, settings.linVelPIDKi, settings.linVelPIDKd);
+	angVelPID.setTunings(settings.angVelPIDKp, settings.angVelPIDKi, settings.angVelPIDKd);
+	linVelPID.setOutputLimits(-maxLinVel, maxLinVel);
+	angVelPID.setOutputLimits(-maxAngVel, maxAngVel);
+
+	positionControl.setVelTunings(settings.linVelKp, settings.angVelKp);
+	positionControl.setVelLimits(settings.linVelMax, settings.angVelMax);
+	positionControl.setPosThresholds(settings.linPosThreshold, settings.angPosThreshold);
+	positionControl.setTimestep(POSITIONCONTROL_TIMESTEP);
+
+	purePursuit.setLookAhead(settings.lookAhead);
+	purePursuit.setLookAheadBis(settings.lookAheadBis);
+	purePursuit.setLookAheadMax(settings.lookAheadMax);
+	purePursuit.setLookAheadGain(settings.lookAheadGain);
+	purePursuit.setMaxLatAcc(settings.maxLatAcc);
+	purePursuit.setCornerRadius(settings.cornerRadius);
+	purePursuit.setVelocityController(velocityControl);
+
+	// Start at the first waypoint, facing along the path
+	const float startAngle = getStartAngle(path[0].end, path[1]) + (direction == PurePursuit::BACKWARD ? M_PI : 0);
+	robot.setPosition(Position(path[0].end.x, path[0].end.y, startAngle));
+	odometry.setPosition(path[0].end.x, path[0].end.y, startAngle);
+
+	// Same as the START_PUREPURSUIT or START_PUREPURSUIT_STREAM instructions
+	purePursuit.reset();
+	for (s_numSent = 0; s_numSent < path.size() && addPathItem(path[s_numSent]); s_numSent++);
+	purePursuit.setDirection(direction);
+	if (lowWatermark >= 0)
+	{
+		purePursuit.setLowWatermark(lowWatermark);
+		purePursuit.setPathOpen(true);
+		streamWaypoints();
+	}
+	else
+	{
+		setFinalAngle();
+		setPosSetpoint(direction);
+	}
+	velocityControl.enable();
+	positionControl.setMoveStrategy(purePursuit);
+	positionControl.enable();
+
+	scheduler.attach(odometry,        Scheduler::INTERRUPT);
+	scheduler.attach(velocityControl, Scheduler::INTERRUPT, velocityControlInputs);
+	scheduler.attach(positionControl, Scheduler::INTERRUPT, positionControlInputs, positionControlOutputs);
+	scheduler.begin();
+}
+
+// Loop, as in wheeledbase.ino
+
+static void loop()
+{
+	scheduler.run();
+}
+
+// Metrics
+
+static void getReferencePath(const std::vector<PathItem>& path, std::vector<PurePursuit::Waypoint>& reference)
+{
+	// The curves are sampled finely enough for the deviation to be measured to the millimeter
+	const int numSamples = 64;
+	reference.push_back(path[0].end);
+	for (size_t i = 1; i < path.size(); i++)
+	{
+		const PurePursuit::Waypoint& start = path[i-1].end;
+		const PathItem& item = path[i];
+		const float chord = hypot(item.end.x - start.x, item.end.y - start.y);
+		const float startAngle = getStartAngle(start, item);
+		const float radius = (item.radius > 0) ? max(item.radius, chord / 2) : min(item.radius, -chord / 2);
+		const float sweep = 2 * asin(min(chord / (2 * abs(radius)), 1.0f)) * ((item.radius > 0) ? 1 : -1);
+		for (int k = 1; k < numSamples && (item.bezier || item.radius != 0); k++)
+		{
+			const float t = (float)k / numSamples;
+			if (item.bezier)
+			{
+				const float b0 = (1-t) * (1-t) * (1-t), b1 = 3 * (1-t) * (1-t) * t, b2 = 3 * (1-t) * t * t, b3 = t * t * t;
+				reference.push_back(PurePursuit::Waypoint(b0 * start.x + b1 * item.control1.x + b2 * item.control2.x + b3 * item.end.x,
+				                                          b0 * start.y + b1 * item.control1.y + b2 * item.control2.y + b3 * item.end.y));
+			}
+			else
+			{
+				const float angle = startAngle + sweep * t;
+				reference.push_back(PurePursuit::Waypoint(start.x + radius * (sin(angle) - sin(startAngle)),
+				                                          start.y + radius * (cos(startAngle) - cos(angle))));
+			}
+		}
+		reference.push_back(item.end);
+	}
+}
+
+static float getDistanceToPath(const std::vector<PurePursuit::Waypoint>& path, float x, float y)
+{
+	float hmin = INFINITY;
+	for (size_t i = 0; i + 1 < path.size(); i++)
+	{
+		const float edgedx = path[i+1].x - path[i].x;
+		const float edgedy = path[i+1].y - path[i].y;
+		const float dx = x - path[i].x;
+		const float dy = y - path[i].y;
+		const float t  = saturate((edgedx * dx + edgedy * dy) / (edgedx * edgedx + edgedy * edgedy), 0, 1);
+		hmin = min(hmin, hypot(dx - t * edgedx, dy - t * edgedy));
+	}
+	return hmin;
+}
+
+static bool parsePathItem(const char* text, std::vector<PathItem>& path)
+{
+	float v[6];
+	int n = sscanf(text, "%f , %f , %f , %f , %f , %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]);
+	if (n < 2)
+		n = sscanf(text, "%f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]);
+	if (n == 2)
+		path.push_back(PathItem(PurePursuit::Waypoint(v[0], v[1])));
+	else if (n == 3)
+		path.push_back(PathItem(PurePursuit::Waypoint(v[0], v[1]), v[2]));
+	else if (n == 6)
+		path.push_back(PathItem(PurePursuit::Waypoint(v[0], v[1]), PurePursuit::Waypoint(v[2], v[3]), PurePursuit::Waypoint(v[4], v[5])));
+	else
+		return false;
+	return true;
+}
+
+static bool readPath(const char* filename, std::vector<PathItem>& path)
+{
+	FILE* file = fopen(filename, "r");
+	if (file == 0)
+		return false;
+	char line[256];
+	while (fgets(line, sizeof(line), file) != 0)
+	{
+		if (line[0] != '#')
+			parsePathItem(line, path);
+	}
+	fclose(file);
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<PathItem>& path = s_path;
+	PurePursuit::Direction direction = PurePursuit::FORWARD;
+	float finalAngle = NAN;
+	float timeout    = 60;
+	int lowWatermark = -1;
+	FILE* csv = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+		{
+			if (!readPath(argv[++i], path))
+			{
+				perror(argv[i]);
+				return 2;
+			}
+		}
+		else if (strcmp(argv[i], "--backward") == 0)
+			direction = PurePursuit::BACKWARD;
+		else if (strcmp(argv[i], "--final-angle") == 0 && i + 1 < argc)
+			finalAngle = atof(argv[++i]);
+		else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc)
+		{
+			if (!setParameter(argv[++i]))
+			{
+				fprintf(stderr, "unknown parameter: %s\n", argv[i]);
+				return 2;
+			}
+		}
+		else if (strcmp(argv[i], "--list") == 0)
+		{
+			for (size_t j = 0; j < sizeof(s_parameters) / sizeof(s_parameters[0]); j++)
+				printf("%s=%g\n", s_parameters[j].name, *s_parameters[j].value);
+			return 0;
+		}
+		else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc)
+			lowWatermark = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+			timeout = atof(argv[++i]);
+		else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+		{
+			csv = fopen(argv[++i], "w");
+			if (csv == 0)
+			{
+				perror(argv[i]);
+				return 2;
+			}
+		}
+		else if (!parsePathItem(argv[i], path))
+		{
+			fprintf(stderr, "usage: %s [--path FILE] [--backward] [--final-angle RAD] [--set NAME=VALUE] [--list] [--stream N] [--timeout S] [--csv FILE] [x,y[,radius]|x1,y1,x2,y2,x,y]...\n", argv[0]);
+			return 2;
+		}
+	}
+	if (path.size() < 2)
+	{
+		fprintf(stderr, "not enough waypoints\n");
+		return 2;
+	}
+	int numWaypoints = 0;
+	for (size_t i = 0; i < path.size(); i++)
+		numWaypoints += path[i].getNumWaypoints();
+	if (numWaypoints > PUREPURSUIT_MAX_WAYPOINTS && lowWatermark < 0)
+	{
+		fprintf(stderr, "too many waypoints, use --stream\n");
+		return 2;
+	}
+	s_finalAngle = finalAngle; // along the end of the path by default
+
+	std::vector<PurePursuit::Waypoint> reference;
+	getReferencePath(path, reference);
+
+	HostClock::useVirtualTime();
+	setup(direction, lowWatermark);
+
+	if (csv != 0)
+		fprintf(csv, "time,x,y,theta,odometry_x,odometry_y,odometry_theta,linvel,angvel,slipping\n");
+
+	const unsigned long timestep = SIMULATION_TIMESTEP * 1e6;
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	unsigned long steps = 0;
+	float maxDeviation = 0;
+	bool  arrived = false;
+	while (steps * timestep < timeout * 1e6)
+	{
+		HostClock::advanceMicros(timestep);
+		robot.step(timestep / 1e6);
+		loop();
+		steps++;
+		if (lowWatermark >= 0 && steps % (STREAMING_PERIOD / timestep) == 0)
+			streamWaypoints();
+
+		const Position& pos = robot.getPosition();
+		maxDeviation = max(maxDeviation, getDistanceToPath(reference, pos.x, pos.y));
+		if (csv != 0 && steps % (10000 / timestep) == 0)
+		{
+			const Position& estimate = odometry.getPosition();
+			fprintf(csv, "%.4f,%.2f,%.2f,%.4f,%.2f,%.2f,%.4f,%.1f,%.3f,%d\n", steps * timestep / 1e6,
+				pos.x, pos.y, pos.theta, estimate.x, estimate.y, estimate.theta, robot.getLinVel(), robot.getAngVel(), robot.isSlipping());
+		}
+
+		if (!velocityControl.isEnabled())
+			break; // Spin urgency
+		if (positionControl.getPositionReached())
+		{
+			arrived = true;
+			break;
+		}
+	}
+	const double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	const double simTime  = steps * timestep / 1e6;
+	if (csv != 0)
+		fclose(csv);
+
+	const Position& pos      = robot.getPosition();
+	const Position& estimate = odometry.getPosition();
+	if (arrived)
+		printf("arrived in %.3f s", simTime);
+	else if (!velocityControl.isEnabled())
+		printf("stopped by the spin urgency after %.3f s", simTime);
+	else
+		printf("not arrived after %.3f s", simTime);
+	printf(" (simulated in %.3f s, %.0fx real time)\n", wallTime, simTime / wallTime);
+	printf("final position error: %.2f mm\n", hypot(pos.x - path.back().end.x, pos.y - path.back().end.y));
+	printf("odometry drift: %.2f mm, %.4f rad\n", hypot(pos.x - estimate.x, pos.y - estimate.y), inrange(pos.theta - estimate.theta, -M_PI, M_PI));
+	printf("max path deviation: %.2f mm\n", maxDeviation);
+	return arrived ? 0 : 1;
+}
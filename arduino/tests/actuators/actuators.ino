@@ -28,23 +28,29 @@ EndStop lowStop;
 
 // 2 tout ou rien à gérer
 
+constexpr SerialTalks::Binding instructions[] PROGMEM =
+{
+  {_SET_MOTOR1_VELOCITY_OPCODE,    SET_MOTOR1_VELOCITY},
+  {_SET_MOTOR2_VELOCITY_OPCODE,    SET_MOTOR2_VELOCITY},
+  {_SET_AX_POSITION_OPCODE,        SET_AX_POSITION},
+  {_GET_AX_TORQUE_OPCODE,          GET_AX_TORQUE},
+  {_SET_AX_VELOCITY_MOVE_OPCODE,   SET_AX_VELOCITY_MOVE},
+  {_PING_AX_OPCODE,                PING_AX},
+  {_SET_AX_HOLD_OPCODE,            SET_AX_HOLD},
+  {_GET_AX_POSITION_OPCODE,        GET_AX_POSITION},
+  {_IS_UP_OPCODE,                  IS_UP},
+  {_IS_DOWN_OPCODE,                IS_DOWN},
+  {_SET_SERVO_OPCODE,              SET_SERVO},
+  {_SET_SERVO_MICROSECONDS_OPCODE, SET_SERVO_MICROSECONDS},
+  {_SET_TOR_OPCODE,                SET_TOR},
+  {_STOP_OPCODE,                   STOP},
+};
+static_assert(SerialTalks::checkBindings(instructions), "instructions opcodes must be unique and not reserved");
+
 void setup(){
   Serial.begin(SERIALTALKS_BAUDRATE);
   talks.begin(Serial);
-  talks.bind(_SET_MOTOR1_VELOCITY_OPCODE, SET_MOTOR1_VELOCITY);
-  talks.bind(_SET_MOTOR2_VELOCITY_OPCODE,  SET_MOTOR2_VELOCITY);
-  talks.bind(_SET_AX_POSITION_OPCODE, SET_AX_POSITION);
-  talks.bind(_GET_AX_TORQUE_OPCODE, GET_AX_TORQUE);
-  talks.bind(_SET_AX_VELOCITY_MOVE_OPCODE,  SET_AX_VELOCITY_MOVE);
-  talks.bind(_PING_AX_OPCODE, PING_AX);
-  talks.bind(_SET_AX_HOLD_OPCODE, SET_AX_HOLD);
-  talks.bind(_GET_AX_POSITION_OPCODE, GET_AX_POSITION);
-  talks.bind(_IS_UP_OPCODE, IS_UP);
-  talks.bind(_IS_DOWN_OPCODE, IS_DOWN);
-  talks.bind(_SET_SERVO_OPCODE, SET_SERVO);
-  talks.bind(_SET_SERVO_MICROSECONDS_OPCODE, SET_SERVO_MICROSECONDS);
-  talks.bind(_SET_TOR_OPCODE, SET_TOR);
-  talks.bind(_STOP_OPCODE, STOP);
+  talks.bind(instructions);
 
   AX12::SerialBegin(9600,RX,TX,DATA_CONTROL);
 
@@ -40,6 +40,26 @@ PositionController positionControl;
 PurePursuit   purePursuit;
 TurnOnTheSpot turnOnTheSpot;
 
+// Instructions
+
+constexpr SerialTalks::Binding instructions[] PROGMEM =
+{
+	{SET_OPENLOOP_VELOCITIES_OPCODE,  SET_OPENLOOP_VELOCITIES},
+	{GET_CODEWHEELS_COUNTERS_OPCODE,  GET_CODEWHEELS_COUNTERS},
+	{SET_VELOCITIES_OPCODE,           SET_VELOCITIES},
+	{RESET_PUREPURSUIT_OPCODE,        RESET_PUREPURSUIT},
+	{ADD_PUREPURSUIT_WAYPOINT_OPCODE, ADD_PUREPURSUIT_WAYPOINT},
+	{START_PUREPURSUIT_OPCODE,        START_PUREPURSUIT},
+	{START_TURNONTHESPOT_OPCODE,      START_TURNONTHESPOT},
+	{POSITION_REACHED_OPCODE,         POSITION_REACHED},
+	{SET_POSITION_OPCODE,             SET_POSITION},
+	{GET_POSITION_OPCODE,             GET_POSITION},
+	{GET_VELOCITIES_OPCODE,           GET_VELOCITIES},
+	{SET_PARAMETER_VALUE_OPCODE,      SET_PARAMETER_VALUE},
+	{GET_PARAMETER_VALUE_OPCODE,      GET_PARAMETER_VALUE},
+};
+static_assert(SerialTalks::checkBindings(instructions), "instructions opcodes must be unique and not reserved");
+
 // Setup
 
 void setup()
@@ -47,19 +67,7 @@ void setup()
 	// Communication
 	Serial.begin(SERIALTALKS_BAUDRATE);
 	talks.begin(Serial);
-	talks.bind(SET_OPENLOOP_VELOCITIES_OPCODE, SET_OPENLOOP_VELOCITIES);
-	talks.bind(GET_CODEWHEELS_COUNTERS_OPCODE, GET_CODEWHEELS_COUNTERS);
-	talks.bind(SET_VELOCITIES_OPCODE, SET_VELOCITIES);
-	talks.bind(RESET_PUREPURSUIT_OPCODE, RESET_PUREPURSUIT);
-	talks.bind(ADD_PUREPURSUIT_WAYPOINT_OPCODE, ADD_PUREPURSUIT_WAYPOINT);
-	talks.bind(START_PUREPURSUIT_OPCODE, START_PUREPURSUIT);
-	talks.bind(START_TURNONTHESPOT_OPCODE, START_TURNONTHESPOT);
-	talks.bind(POSITION_REACHED_OPCODE, POSITION_REACHED);
-	talks.bind(SET_POSITION_OPCODE, SET_POSITION);
-	talks.bind(GET_POSITION_OPCODE, GET_POSITION);
-	talks.bind(GET_VELOCITIES_OPCODE, GET_VELOCITIES);
-	talks.bind(SET_PARAMETER_VALUE_OPCODE, SET_PARAMETER_VALUE);
-	talks.bind(GET_PARAMETER_VALUE_OPCODE, GET_PARAMETER_VALUE);
+	talks.bind(instructions);
 
 	// DC motors wheels
 	driver.attach(DRIVER_RESET, DRIVER_FAULT);
@@ -120,7 +128,7 @@ void setup()
 
 void loop()
 {	
-	talks.execute();
+	talks.execute(SERIALTALKS_EXECUTE_BUDGET);
 
 	// Update odometry
 	if (odometry.update())
@@ -10,7 +10,7 @@
 #define LINVELPID_ADDRESS		    0x140 // 20 bytes
 #define ANGVELPID_ADDRESS           0x180 // 20 bytes
 #define POSITIONCONTROL_ADDRESS     0x200 // 16 bytes
-#define PUREPURSUIT_ADDRESS         0x240 //  4 bytes
+#define PUREPURSUIT_ADDRESS         0x240 // 24 bytes
 #define SMOOTHTRAJECTORY_ADDRESS    0x280 //  4 bytes
 
 #endif // __ADDRESSES_H__
@@ -45,4 +45,8 @@
 #define PID_CONTROLLERS_TIMESTEP  20e-3 // s
 #define POSITIONCONTROL_TIMESTEP  50e-3 // s
 
+// Communication
+
+#define SERIALTALKS_EXECUTE_BUDGET 1000 // us, so that a burst of instructions never delays odometry
+
 #endif // __CONSTANTS_H__
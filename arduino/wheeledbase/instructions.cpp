@@ -3,6 +3,7 @@
 #include "addresses.h"
 
 #include "../common/SerialTalks.h"
+#include "../common/Scheduler.h"
 #include "../common/DCMotor.h"
 #include "../common/Codewheel.h"
 #include "../common/Odometry.h"
@@ -35,13 +36,21 @@ extern PositionController positionControl;
 extern PurePursuit   purePursuit;
 extern TurnOnTheSpot turnOnTheSpot;
 
+#if ENABLE_FLIGHTRECORDER
+extern FlightRecorder recorder;
+#endif // ENABLE_FLIGHTRECORDER
+
 // Instructions
+//
+// They hold a Scheduler::Lock while they access the control tasks, which otherwise run from the
+// Timer1 interrupt (see wheeledbase.ino)
 
 void SET_OPENLOOP_VELOCITIES(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
 	float leftWheelVel  = input.read<float>();
 	float rightWheelVel = input.read<float>();
 
+	Scheduler::Lock lock;
 	velocityControl.disable();
 	positionControl.disable();
 	leftWheel .setVelocity(leftWheelVel);
@@ -50,6 +59,7 @@ void SET_OPENLOOP_VELOCITIES(SerialTalks& talks, Deserializer& input, Serializer
 
 void GET_CODEWHEELS_COUNTERS(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
+	Scheduler::Lock lock;
 	long leftCodewheelCounter  = leftCodewheel. getCounter();
 	long rightCodewheelCounter = rightCodewheel.getCounter();
 
@@ -61,6 +71,7 @@ void SET_VELOCITIES(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
 	float linVelSetpoint = input.read<float>();
 	float angVelSetpoint = input.read<float>();
+	Scheduler::Lock lock;
 	positionControl.disable();
 	velocityControl.enable();
 	velocityControl.setSetpoints(linVelSetpoint, angVelSetpoint);
@@ -68,30 +79,55 @@ void SET_VELOCITIES(SerialTalks& talks, Deserializer& input, Serializer& output)
 
 void RESET_PUREPURSUIT(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
+	Scheduler::Lock lock;
 	purePursuit.reset();
 	positionControl.disable();
 }
 
-void START_PUREPURSUIT(SerialTalks& talks, Deserializer& input, Serializer& output)
+static void setPurePursuitDirection(byte direction)
 {
-	// Setup PurePursuit
-	byte direction = input.read<byte>();
 	switch (direction)
 	{
 	case 0: purePursuit.setDirection(PurePursuit::FORWARD); break;
 	case 1: purePursuit.setDirection(PurePursuit::BACKWARD); break;
 	}
-	purePursuit.setFinalAngle(input.read<float>());
+}
 
-	// Compute final setpoint
-	const PurePursuit::Waypoint wp0 = purePursuit.getWaypoint(purePursuit.getNumWaypoints() - 2);
-	const PurePursuit::Waypoint wp1 = purePursuit.getWaypoint(purePursuit.getNumWaypoints() - 1);
-	positionControl.setPosSetpoint(Position(wp1.x, wp1.y, atan2(wp1.y - wp0.y, wp1.x - wp0.x) + direction * M_PI));
+static void setPurePursuitPosSetpoint()
+{
+	// The last waypoint, facing along the end of the path
+	const int numWaypoints = purePursuit.getNumWaypoints();
+	if (numWaypoints < 2)
+		return;
+	const PurePursuit::Waypoint wp1 = purePursuit.getWaypoint(numWaypoints - 1);
+	const float reverse = (purePursuit.getDirection() == PurePursuit::BACKWARD) ? M_PI : 0;
+	positionControl.setPosSetpoint(Position(wp1.x, wp1.y, purePursuit.getEndAngle() + reverse));
+}
 
-	// Enable PurePursuit controller
+static void enablePurePursuit()
+{
 	velocityControl.enable();
 	positionControl.setMoveStrategy(purePursuit);
 	positionControl.enable();
+#if ENABLE_FLIGHTRECORDER
+	recorder.trigger(FlightRecorder::GOAL_START);
+#endif // ENABLE_FLIGHTRECORDER
+}
+
+void START_PUREPURSUIT(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	// Setup PurePursuit
+	byte direction = input.read<byte>();
+	Scheduler::Lock lock;
+	setPurePursuitDirection(direction);
+	purePursuit.setFinalAngle(input.read<float>());
+	purePursuit.setPathOpen(false);
+
+	// Compute final setpoint
+	setPurePursuitPosSetpoint();
+
+	// Enable PurePursuit controller
+	enablePurePursuit();
 }
 
 void ADD_PUREPURSUIT_WAYPOINT(SerialTalks& talks, Deserializer& input, Serializer& output)
@@ -99,21 +135,27 @@ void ADD_PUREPURSUIT_WAYPOINT(SerialTalks& talks, Deserializer& input, Serialize
 	// Queue waypoint
 	float x = input.read<float>();
 	float y = input.read<float>();
+	Scheduler::Lock lock;
 	purePursuit.addWaypoint(PurePursuit::Waypoint(x, y));
 }
 
 void START_TURNONTHESPOT(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
+	Scheduler::Lock lock;
 	Position posSetpoint = odometry.getPosition();
 	posSetpoint.theta = input.read<float>();
 	velocityControl.enable();
 	positionControl.setPosSetpoint(posSetpoint);
 	positionControl.setMoveStrategy(turnOnTheSpot);
 	positionControl.enable();
+#if ENABLE_FLIGHTRECORDER
+	recorder.trigger(FlightRecorder::GOAL_START);
+#endif // ENABLE_FLIGHTRECORDER
 }
 
 void POSITION_REACHED(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
+	Scheduler::Lock lock;
 	bool positionReached = positionControl.getPositionReached() && positionControl.isEnabled();
 	bool spinUrgency = !velocityControl.isEnabled();
 	output.write<byte>(positionReached);
@@ -126,11 +168,13 @@ void SET_POSITION(SerialTalks& talks, Deserializer& input, Serializer& output)
 	float y     = input.read<float>();
 	float theta = input.read<float>();
 
+	Scheduler::Lock lock;
 	odometry.setPosition(x, y, theta);
 }
 
 void GET_POSITION(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
+	Scheduler::Lock lock;
 	const Position& pos = odometry.getPosition();
 	
 	output.write<float>(pos.x);
@@ -140,6 +184,7 @@ void GET_POSITION(SerialTalks& talks, Deserializer& input, Serializer& output)
 
 void GET_VELOCITIES(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
+	Scheduler::Lock lock;
 	const float linVel = odometry.getLinVel();
 	const float angVel = odometry.getAngVel();
 	
@@ -150,159 +195,214 @@ void GET_VELOCITIES(SerialTalks& talks, Deserializer& input, Serializer& output)
 void SET_PARAMETER_VALUE(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
 	byte  id = input.read<byte>();
+
+	// Update the parameter out of reach of the control tasks
+	{
+		Scheduler::Lock lock;
+		switch (id)
+		{
+		case LEFTWHEEL_RADIUS_ID:
+			leftWheel.setWheelRadius(input.read<float>());
+			break;
+		case LEFTWHEEL_CONSTANT_ID:
+			leftWheel.setConstant(input.read<float>());
+			break;
+		case LEFTWHEEL_MAXPWM_ID:
+			leftWheel.setMaxPWM(input.read<float>());
+			break;
+		
+		case RIGHTWHEEL_RADIUS_ID:
+			rightWheel.setWheelRadius(input.read<float>());
+			break;
+		case RIGHTWHEEL_CONSTANT_ID:
+			rightWheel.setConstant(input.read<float>());
+			break;
+		case RIGHTWHEEL_MAXPWM_ID:
+			rightWheel.setMaxPWM(input.read<float>());
+			break;
+
+		case LEFTCODEWHEEL_RADIUS_ID:
+			leftCodewheel.setWheelRadius(input.read<float>());
+			break;
+		case LEFTCODEWHEEL_COUNTSPERREV_ID:
+			leftCodewheel.setCountsPerRev(input.read<long>());
+			break;
+		
+		case RIGHTCODEWHEEL_RADIUS_ID:
+			rightCodewheel.setWheelRadius(input.read<float>());
+			break;
+		case RIGHTCODEWHEEL_COUNTSPERREV_ID:
+			rightCodewheel.setCountsPerRev(input.read<long>());
+			break;
+		
+		case ODOMETRY_AXLETRACK_ID:
+			odometry.setAxleTrack(input.read<float>());
+			break;
+		case ODOMETRY_SLIPPAGE_ID:
+			odometry.setSlippage(input.read<float>());
+			break;
+		
+		case VELOCITYCONTROL_AXLETRACK_ID:
+			velocityControl.setAxleTrack(input.read<float>());
+			break;
+		case VELOCITYCONTROL_MAXLINACC_ID:
+			velocityControl.setMaxAcc(input.read<float>(), velocityControl.getMaxAngAcc());
+			break;
+		case VELOCITYCONTROL_MAXLINDEC_ID:
+			velocityControl.setMaxDec(input.read<float>(), velocityControl.getMaxAngDec());
+			break;
+		case VELOCITYCONTROL_MAXANGACC_ID:
+			velocityControl.setMaxAcc(velocityControl.getMaxLinAcc(), input.read<float>());
+			break;
+		case VELOCITYCONTROL_MAXANGDEC_ID:
+			velocityControl.setMaxDec(velocityControl.getMaxLinDec(), input.read<float>());
+			break;
+		case VELOCITYCONTROL_SPINSHUTDOWN_ID:
+			velocityControl.setSpinShutdown(input.read<byte>());
+			break;
+		
+		case LINVELPID_KP_ID:
+			linVelPID.setTunings(input.read<float>(), linVelPID.getKi(), linVelPID.getKd());
+			break;
+		case LINVELPID_KI_ID:
+			linVelPID.setTunings(linVelPID.getKp(), input.read<float>(), linVelPID.getKd());
+			break;
+		case LINVELPID_KD_ID:
+			linVelPID.setTunings(linVelPID.getKp(), linVelPID.getKi(), input.read<float>());
+			break;
+		case LINVELPID_MINOUTPUT_ID:
+			linVelPID.setOutputLimits(input.read<float>(), linVelPID.getMaxOutput());
+			break;
+		case LINVELPID_MAXOUTPUT_ID:
+			linVelPID.setOutputLimits(linVelPID.getMinOutput(), input.read<float>());
+			break;
+		
+		case ANGVELPID_KP_ID:
+			angVelPID.setTunings(input.read<float>(), angVelPID.getKi(), angVelPID.getKd());
+			break;
+		case ANGVELPID_KI_ID:
+			angVelPID.setTunings(angVelPID.getKp(), input.read<float>(), angVelPID.getKd());
+			break;
+		case ANGVELPID_KD_ID:
+			angVelPID.setTunings(angVelPID.getKp(), angVelPID.getKi(), input.read<float>());
+			break;
+		case ANGVELPID_MINOUTPUT_ID:
+			angVelPID.setOutputLimits(input.read<float>(), angVelPID.getMaxOutput());
+			break;
+		case ANGVELPID_MAXOUTPUT_ID:
+			angVelPID.setOutputLimits(angVelPID.getMinOutput(), input.read<float>());
+			break;
+		
+		case POSITIONCONTROL_LINVELKP_ID:
+			positionControl.setVelTunings(input.read<float>(), positionControl.getAngVelKp());
+			break;
+		case POSITIONCONTROL_ANGVELKP_ID:
+			positionControl.setVelTunings(positionControl.getLinVelKp(), input.read<float>());
+			break;
+		case POSITIONCONTROL_LINVELMAX_ID:
+			positionControl.setVelLimits(input.read<float>(), positionControl.getAngVelMax());
+			break;
+		case POSITIONCONTROL_ANGVELMAX_ID:
+			positionControl.setVelLimits(positionControl.getLinVelMax(), input.read<float>());
+			break;
+		case POSITIONCONTROL_LINPOSTHRESHOLD_ID:
+			positionControl.setPosThresholds(input.read<float>(), positionControl.getAngPosThreshold());
+			break;
+		case POSITIONCONTROL_ANGPOSTHRESHOLD_ID:
+			positionControl.setPosThresholds(positionControl.getLinPosThreshold(), input.read<float>());
+			break;
+
+		case PUREPURSUIT_LOOKAHED_ID:
+			purePursuit.setLookAhead(input.read<float>());
+			break;
+		case PUREPURSUIT_LOOKAHEADBIS_ID:
+			purePursuit.setLookAheadBis(input.read<float>());
+			break;
+		case PUREPURSUIT_LOOKAHEADMAX_ID:
+			purePursuit.setLookAheadMax(input.read<float>());
+			break;
+		case PUREPURSUIT_LOOKAHEADGAIN_ID:
+			purePursuit.setLookAheadGain(input.read<float>());
+			break;
+		case PUREPURSUIT_MAXLATACC_ID:
+			purePursuit.setMaxLatAcc(input.read<float>());
+			break;
+		case PUREPURSUIT_CORNERRADIUS_ID:
+			purePursuit.setCornerRadius(input.read<float>());
+			break;
+		}
+	}
+
+	// Then save it without masking the control tasks, as each EEPROM byte takes 3.3 ms to write
 	switch (id)
 	{
 	case LEFTWHEEL_RADIUS_ID:
-		leftWheel.setWheelRadius(input.read<float>());
-		leftWheel.save(LEFTWHEEL_ADDRESS);
-		break;
 	case LEFTWHEEL_CONSTANT_ID:
-		leftWheel.setConstant(input.read<float>());
-		leftWheel.save(LEFTWHEEL_ADDRESS);
-		break;
 	case LEFTWHEEL_MAXPWM_ID:
-		leftWheel.setMaxPWM(input.read<float>());
 		leftWheel.save(LEFTWHEEL_ADDRESS);
 		break;
-	
+
 	case RIGHTWHEEL_RADIUS_ID:
-		rightWheel.setWheelRadius(input.read<float>());
-		rightWheel.save(RIGHTWHEEL_ADDRESS);
-		break;
 	case RIGHTWHEEL_CONSTANT_ID:
-		rightWheel.setConstant(input.read<float>());
-		rightWheel.save(RIGHTWHEEL_ADDRESS);
-		break;
 	case RIGHTWHEEL_MAXPWM_ID:
-		rightWheel.setMaxPWM(input.read<float>());
 		rightWheel.save(RIGHTWHEEL_ADDRESS);
 		break;
 
 	case LEFTCODEWHEEL_RADIUS_ID:
-		leftCodewheel.setWheelRadius(input.read<float>());
-		leftCodewheel.save(LEFTCODEWHEEL_ADDRESS);
-		break;
 	case LEFTCODEWHEEL_COUNTSPERREV_ID:
-		leftCodewheel.setCountsPerRev(input.read<long>());
 		leftCodewheel.save(LEFTCODEWHEEL_ADDRESS);
 		break;
-	
+
 	case RIGHTCODEWHEEL_RADIUS_ID:
-		rightCodewheel.setWheelRadius(input.read<float>());
-		rightCodewheel.save(RIGHTCODEWHEEL_ADDRESS);
-		break;
 	case RIGHTCODEWHEEL_COUNTSPERREV_ID:
-		rightCodewheel.setCountsPerRev(input.read<long>());
 		rightCodewheel.save(RIGHTCODEWHEEL_ADDRESS);
 		break;
-	
+
 	case ODOMETRY_AXLETRACK_ID:
-		odometry.setAxleTrack(input.read<float>());
-		odometry.save(ODOMETRY_ADDRESS);
-		break;
 	case ODOMETRY_SLIPPAGE_ID:
-		odometry.setSlippage(input.read<float>());
 		odometry.save(ODOMETRY_ADDRESS);
 		break;
-	
+
 	case VELOCITYCONTROL_AXLETRACK_ID:
-		velocityControl.setAxleTrack(input.read<float>());
-		velocityControl.save(VELOCITYCONTROL_ADDRESS);
-		break;
 	case VELOCITYCONTROL_MAXLINACC_ID:
-		velocityControl.setMaxAcc(input.read<float>(), velocityControl.getMaxAngAcc());
-		velocityControl.save(VELOCITYCONTROL_ADDRESS);
-		break;
 	case VELOCITYCONTROL_MAXLINDEC_ID:
-		velocityControl.setMaxDec(input.read<float>(), velocityControl.getMaxAngDec());
-		velocityControl.save(VELOCITYCONTROL_ADDRESS);
-		break;
 	case VELOCITYCONTROL_MAXANGACC_ID:
-		velocityControl.setMaxAcc(velocityControl.getMaxLinAcc(), input.read<float>());
-		velocityControl.save(VELOCITYCONTROL_ADDRESS);
-		break;
 	case VELOCITYCONTROL_MAXANGDEC_ID:
-		velocityControl.setMaxDec(velocityControl.getMaxLinDec(), input.read<float>());
-		velocityControl.save(VELOCITYCONTROL_ADDRESS);
-		break;
 	case VELOCITYCONTROL_SPINSHUTDOWN_ID:
-		velocityControl.setSpinShutdown(input.read<byte>());
 		velocityControl.save(VELOCITYCONTROL_ADDRESS);
 		break;
-	
+
 	case LINVELPID_KP_ID:
-		linVelPID.setTunings(input.read<float>(), linVelPID.getKi(), linVelPID.getKd());
-		linVelPID.save(LINVELPID_ADDRESS);
-		break;
 	case LINVELPID_KI_ID:
-		linVelPID.setTunings(linVelPID.getKp(), input.read<float>(), linVelPID.getKd());
-		linVelPID.save(LINVELPID_ADDRESS);
-		break;
 	case LINVELPID_KD_ID:
-		linVelPID.setTunings(linVelPID.getKp(), linVelPID.getKi(), input.read<float>());
-		linVelPID.save(LINVELPID_ADDRESS);
-		break;
 	case LINVELPID_MINOUTPUT_ID:
-		linVelPID.setOutputLimits(input.read<float>(), linVelPID.getMaxOutput());
-		linVelPID.save(LINVELPID_ADDRESS);
-		break;
 	case LINVELPID_MAXOUTPUT_ID:
-		linVelPID.setOutputLimits(linVelPID.getMinOutput(), input.read<float>());
 		linVelPID.save(LINVELPID_ADDRESS);
 		break;
-	
+
 	case ANGVELPID_KP_ID:
-		angVelPID.setTunings(input.read<float>(), angVelPID.getKi(), angVelPID.getKd());
-		angVelPID.save(ANGVELPID_ADDRESS);
-		break;
 	case ANGVELPID_KI_ID:
-		angVelPID.setTunings(angVelPID.getKp(), input.read<float>(), angVelPID.getKd());
-		angVelPID.save(ANGVELPID_ADDRESS);
-		break;
 	case ANGVELPID_KD_ID:
-		angVelPID.setTunings(angVelPID.getKp(), angVelPID.getKi(), input.read<float>());
-		angVelPID.save(ANGVELPID_ADDRESS);
-		break;
 	case ANGVELPID_MINOUTPUT_ID:
-		angVelPID.setOutputLimits(input.read<float>(), angVelPID.getMaxOutput());
-		angVelPID.save(ANGVELPID_ADDRESS);
-		break;
 	case ANGVELPID_MAXOUTPUT_ID:
-		angVelPID.setOutputLimits(angVelPID.getMinOutput(), input.read<float>());
 		angVelPID.save(ANGVELPID_ADDRESS);
 		break;
-	
+
 	case POSITIONCONTROL_LINVELKP_ID:
-		positionControl.setVelTunings(input.read<float>(), positionControl.getAngVelKp());
-		positionControl.save(POSITIONCONTROL_ADDRESS);
-		break;
 	case POSITIONCONTROL_ANGVELKP_ID:
-		positionControl.setVelTunings(positionControl.getLinVelKp(), input.read<float>());
-		positionControl.save(POSITIONCONTROL_ADDRESS);
-		break;
 	case POSITIONCONTROL_LINVELMAX_ID:
-		positionControl.setVelLimits(input.read<float>(), positionControl.getAngVelMax());
-		positionControl.save(POSITIONCONTROL_ADDRESS);
-		break;
 	case POSITIONCONTROL_ANGVELMAX_ID:
-		positionControl.setVelLimits(positionControl.getLinVelMax(), input.read<float>());
-		positionControl.save(POSITIONCONTROL_ADDRESS);
-		break;
 	case POSITIONCONTROL_LINPOSTHRESHOLD_ID:
-		positionControl.setPosThresholds(input.read<float>(), positionControl.getAngPosThreshold());
-		positionControl.save(POSITIONCONTROL_ADDRESS);
-		break;
 	case POSITIONCONTROL_ANGPOSTHRESHOLD_ID:
-		positionControl.setPosThresholds(positionControl.getLinPosThreshold(), input.read<float>());
 		positionControl.save(POSITIONCONTROL_ADDRESS);
 		break;
 
 	case PUREPURSUIT_LOOKAHED_ID:
-		purePursuit.setLookAhead(input.read<float>());
-		purePursuit.save(PUREPURSUIT_ADDRESS);
-		break;
 	case PUREPURSUIT_LOOKAHEADBIS_ID:
-		purePursuit.setLookAheadBis(input.read<float>());
+	case PUREPURSUIT_LOOKAHEADMAX_ID:
+	case PUREPURSUIT_LOOKAHEADGAIN_ID:
+	case PUREPURSUIT_MAXLATACC_ID:
+	case PUREPURSUIT_CORNERRADIUS_ID:
 		purePursuit.save(PUREPURSUIT_ADDRESS);
 		break;
 	}
@@ -311,6 +411,7 @@ void SET_PARAMETER_VALUE(SerialTalks& talks, Deserializer& input, Serializer& ou
 void GET_PARAMETER_VALUE(SerialTalks& talks, Deserializer& input, Serializer& output)
 {
 	byte id = input.read<byte>();
+	Scheduler::Lock lock;
 	switch (id)
 	{
 	case LEFTWHEEL_RADIUS_ID:
@@ -430,6 +531,215 @@ void GET_PARAMETER_VALUE(SerialTalks& talks, Deserializer& input, Serializer& ou
 	case PUREPURSUIT_LOOKAHEADBIS_ID:
 		output.write<float>(purePursuit.getLookAheadBis());
 		break;
+	case PUREPURSUIT_LOOKAHEADMAX_ID:
+		output.write<float>(purePursuit.getLookAheadMax());
+		break;
+	case PUREPURSUIT_LOOKAHEADGAIN_ID:
+		output.write<float>(purePursuit.getLookAheadGain());
+		break;
+	case PUREPURSUIT_MAXLATACC_ID:
+		output.write<float>(purePursuit.getMaxLatAcc());
+		break;
+	case PUREPURSUIT_CORNERRADIUS_ID:
+		output.write<float>(purePursuit.getCornerRadius());
+		break;
+	}
+}
+
+void SET_POSITION_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	float x     = input.read<Millimeters>();
+	float y     = input.read<Millimeters>();
+	float theta = input.read<Radians>();
+
+	Scheduler::Lock lock;
+	odometry.setPosition(x, y, theta);
+}
+
+void GET_POSITION_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	Scheduler::Lock lock;
+	const Position& pos = odometry.getPosition();
+
+	output.write<Millimeters>(pos.x);
+	output.write<Millimeters>(pos.y);
+	output.write<Radians>(pos.theta);
+}
+
+void SET_VELOCITIES_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	float linVelSetpoint = input.read<Millimeters>();
+	float angVelSetpoint = input.read<RadiansPerSecond>();
+	Scheduler::Lock lock;
+	positionControl.disable();
+	velocityControl.enable();
+	velocityControl.setSetpoints(linVelSetpoint, angVelSetpoint);
+}
+
+void GET_VELOCITIES_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	Scheduler::Lock lock;
+	const float linVel = odometry.getLinVel();
+	const float angVel = odometry.getAngVel();
+
+	output.write<Millimeters>(linVel);
+	output.write<RadiansPerSecond>(angVel);
+}
+
+void ADD_PUREPURSUIT_WAYPOINT_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	// Queue waypoint
+	float x = input.read<Millimeters>();
+	float y = input.read<Millimeters>();
+	Scheduler::Lock lock;
+	purePursuit.addWaypoint(PurePursuit::Waypoint(x, y));
+}
+
+void START_PUREPURSUIT_STREAM(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	// Same as above but the path stays open until END_PUREPURSUIT_PATH: the host keeps appending
+	// waypoints while the robot drives, whenever PUREPURSUIT_LOW_WATERMARK asks for them
+	byte direction    = input.read<byte>();
+	byte lowWatermark = input.read<byte>();
+	Scheduler::Lock lock;
+	setPurePursuitDirection(direction);
+	purePursuit.setLowWatermark(lowWatermark);
+	purePursuit.setPathOpen(true);
+	enablePurePursuit();
+}
+
+void END_PUREPURSUIT_PATH(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	float finalAngle = input.read<float>();
+	Scheduler::Lock lock;
+	purePursuit.setFinalAngle(finalAngle);
+	purePursuit.setPathOpen(false);
+	setPurePursuitPosSetpoint();
+}
+
+void PUREPURSUIT_LOW_WATERMARK(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	// Meant to be subscribed to: it only answers when an open path is running out of waypoints,
+	// with the number of waypoints received since the reset and the number of free slots
+	Scheduler::Lock lock;
+	if (purePursuit.isBelowLowWatermark())
+	{
+		output.write<unsigned int>(purePursuit.getNumReceivedWaypoints());
+		output.write<byte>(purePursuit.getNumFreeWaypoints());
+	}
+}
+
+void ADD_PUREPURSUIT_ARC(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	// Queue an arc from the last waypoint, turning left for a positive radius
+	float x = input.read<float>();
+	float y = input.read<float>();
+	float radius = input.read<float>();
+	Scheduler::Lock lock;
+	purePursuit.addArc(PurePursuit::Waypoint(x, y), radius);
+}
+
+void ADD_PUREPURSUIT_BEZIER(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	// Queue a cubic Bezier curve from the last waypoint, given its two control points and its end
+	float x1 = input.read<float>();
+	float y1 = input.read<float>();
+	float x2 = input.read<float>();
+	float y2 = input.read<float>();
+	float x  = input.read<float>();
+	float y  = input.read<float>();
+	Scheduler::Lock lock;
+	purePursuit.addBezier(PurePursuit::Waypoint(x1, y1), PurePursuit::Waypoint(x2, y2), PurePursuit::Waypoint(x, y));
+}
+
+void GET_SCHEDULER_STATISTICS(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	byte task  = input.read<byte>();
+	byte reset = input.read<byte>();
+	if (task < scheduler.getNumTasks())
+	{
+		output.write<unsigned long>(scheduler.getLastJitter(task));
+		output.write<unsigned long>(scheduler.getMaxJitter(task));
+		output.write<unsigned int>(scheduler.getOverruns(task));
+		output.write<unsigned long>(scheduler.getMissedDeadlines(task));
+	}
+	if (reset)
+		scheduler.resetStatistics();
+}
+
+#if ENABLE_PROFILER
+static void writeProfileStatistics(Serializer& output, const Profiler::Statistics& statistics)
+{
+	output.write<unsigned long>(statistics.count);
+	output.write<unsigned int>(statistics.min);
+	output.write<unsigned int>(statistics.getMean());
+	output.write<unsigned int>(statistics.max);
+	for (int i = 0; i < PROFILER_HISTOGRAM_BINS; i++)
+		output.write<unsigned int>(statistics.histogram[i]);
+}
+
+static_assert(2 * (4 + 2 * (3 + PROFILER_HISTOGRAM_BINS)) <= SERIALTALKS_OUTPUT_BUFFER_SIZE, "the profile must fit in one response");
+
+void GET_PROFILE(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	byte section = input.read<byte>();
+	byte reset   = input.read<byte>();
+	Scheduler::Lock lock;
+	if (section < profiler.getNumSections())
+	{
+		writeProfileStatistics(output, profiler.getDuration(section));
+		writeProfileStatistics(output, profiler.getJitter(section));
 	}
+	if (reset)
+		profiler.reset();
+}
+#endif // ENABLE_PROFILER
+
+#if ENABLE_FLIGHTRECORDER
+void ARM_FLIGHTRECORDER(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	byte triggers        = input.read<byte>();
+	unsigned int samples = input.read<unsigned int>();
+	Scheduler::Lock lock;
+	recorder.arm(triggers, samples);
 }
 
+void TRIGGER_FLIGHTRECORDER(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	Scheduler::Lock lock;
+	recorder.trigger(FlightRecorder::HOST);
+}
+
+void GET_FLIGHTRECORDER_STATUS(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	Scheduler::Lock lock;
+	output.write<byte>(recorder.getState());
+	output.write<byte>(recorder.getTrigger());
+	output.write<unsigned int>(recorder.getNumSamples());
+	output.write<unsigned int>(recorder.getTriggerIndex());
+	output.write<float>(odometry.getTimestep());
+}
+
+void GET_FLIGHTRECORDER_SAMPLES(SerialTalks& talks, Deserializer& input, Serializer& output)
+{
+	// As many samples as fit in one response: the host sends these requests one after the other
+	// to dump the whole buffer
+	const int maxCount = SERIALTALKS_OUTPUT_BUFFER_SIZE / sizeof(FlightRecorder::Sample);
+	int first = input.read<unsigned int>();
+	int count = min((int)input.read<byte>(), maxCount);
+	Scheduler::Lock lock;
+	for (int i = first; i < first + count && i < recorder.getNumSamples(); i++)
+	{
+		const FlightRecorder::Sample& sample = recorder.getSample(i);
+		output.write<int16_t>(sample.linSetpoint);
+		output.write<int16_t>(sample.linInput);
+		output.write<int16_t>(sample.linOutput);
+		output.write<int16_t>(sample.angSetpoint);
+		output.write<int16_t>(sample.angInput);
+		output.write<int16_t>(sample.angOutput);
+		output.write<int16_t>(sample.x);
+		output.write<int16_t>(sample.y);
+		output.write<int16_t>(sample.theta);
+	}
+}
+#endif // ENABLE_FLIGHTRECORDER
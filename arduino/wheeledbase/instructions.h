@@ -2,6 +2,8 @@
 #define __INSTRUCTIONS_H__
 
 #include "../common/SerialTalks.h"
+#include "../common/Profiler.h"
+#include "../common/FlightRecorder.h"
 
 // Opcodes declaration
 
@@ -26,6 +28,42 @@
 #define RESET_PUREPURSUIT_OPCODE        0x10
 #define ADD_PUREPURSUIT_WAYPOINT_OPCODE 0x11
 
+// Same as above but with compact encodings (see serialutils.h): distances and velocities are
+// integers in mm and mm/s, and angles are fixed-point numbers
+
+#define SET_POSITION_COMPACT_OPCODE             0x12
+#define GET_POSITION_COMPACT_OPCODE             0x13
+#define SET_VELOCITIES_COMPACT_OPCODE           0x14
+#define GET_VELOCITIES_COMPACT_OPCODE           0x15
+#define ADD_PUREPURSUIT_WAYPOINT_COMPACT_OPCODE 0x16
+
+// Jitters and overruns of the control tasks (see Scheduler.h)
+
+#define GET_SCHEDULER_STATISTICS_OPCODE 0x17
+
+// Execution times and jitters of the profiled sections, if ENABLE_PROFILER is set (see Profiler.h)
+
+#define GET_PROFILE_OPCODE              0x18
+
+// Control loop samples recorded around a trigger, if ENABLE_FLIGHTRECORDER is set (see
+// FlightRecorder.h)
+
+#define ARM_FLIGHTRECORDER_OPCODE         0x19
+#define TRIGGER_FLIGHTRECORDER_OPCODE     0x1A
+#define GET_FLIGHTRECORDER_STATUS_OPCODE  0x1B
+#define GET_FLIGHTRECORDER_SAMPLES_OPCODE 0x1C
+
+// PurePursuit on a path streamed while the robot drives (see PurePursuit::setPathOpen)
+
+#define START_PUREPURSUIT_STREAM_OPCODE  0x1D
+#define END_PUREPURSUIT_PATH_OPCODE      0x1E
+#define PUREPURSUIT_LOW_WATERMARK_OPCODE 0x1F
+
+// PurePursuit curved segments (see PurePursuit::addArc and PurePursuit::addBezier)
+
+#define ADD_PUREPURSUIT_ARC_OPCODE       0x20
+#define ADD_PUREPURSUIT_BEZIER_OPCODE    0x21
+
 // Parameters identifiers
 
 #define LEFTWHEEL_RADIUS_ID             0x10
@@ -64,6 +102,10 @@
 #define POSITIONCONTROL_ANGPOSTHRESHOLD_ID  0xD5
 #define PUREPURSUIT_LOOKAHED_ID         0xE0
 #define PUREPURSUIT_LOOKAHEADBIS_ID     0xE2
+#define PUREPURSUIT_LOOKAHEADMAX_ID     0xE3
+#define PUREPURSUIT_LOOKAHEADGAIN_ID    0xE4
+#define PUREPURSUIT_MAXLATACC_ID        0xE5
+#define PUREPURSUIT_CORNERRADIUS_ID     0xE6
 
 // Instructions prototypes
 
@@ -93,4 +135,40 @@ void SET_PARAMETER_VALUE(SerialTalks& talks, Deserializer& input, Serializer& ou
 
 void GET_PARAMETER_VALUE(SerialTalks& talks, Deserializer& input, Serializer& output);
 
+void SET_POSITION_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void GET_POSITION_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void SET_VELOCITIES_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void GET_VELOCITIES_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void ADD_PUREPURSUIT_WAYPOINT_COMPACT(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void START_PUREPURSUIT_STREAM(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void END_PUREPURSUIT_PATH(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void PUREPURSUIT_LOW_WATERMARK(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void ADD_PUREPURSUIT_ARC(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void ADD_PUREPURSUIT_BEZIER(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void GET_SCHEDULER_STATISTICS(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+#if ENABLE_PROFILER
+void GET_PROFILE(SerialTalks& talks, Deserializer& input, Serializer& output);
+#endif // ENABLE_PROFILER
+
+#if ENABLE_FLIGHTRECORDER
+void ARM_FLIGHTRECORDER(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void TRIGGER_FLIGHTRECORDER(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void GET_FLIGHTRECORDER_STATUS(SerialTalks& talks, Deserializer& input, Serializer& output);
+
+void GET_FLIGHTRECORDER_SAMPLES(SerialTalks& talks, Deserializer& input, Serializer& output);
+#endif // ENABLE_FLIGHTRECORDER
+
 #endif // __INSTRUCTIONS_H__
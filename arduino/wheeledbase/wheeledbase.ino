@@ -6,6 +6,9 @@
 #include "addresses.h"
 
 #include "../common/SerialTalks.h"
+#include "../common/Scheduler.h"
+#include "../common/Profiler.h"
+#include "../common/FlightRecorder.h"
 #include "../common/DCMotor.h"
 #include "../common/Codewheel.h"
 #include "../common/Odometry.h"
@@ -40,6 +43,83 @@ PositionController positionControl;
 PurePursuit   purePursuit;
 TurnOnTheSpot turnOnTheSpot;
 
+#if ENABLE_FLIGHTRECORDER
+FlightRecorder recorder;
+#endif // ENABLE_FLIGHTRECORDER
+
+// Data exchanged between the control tasks (see Scheduler.h)
+
+#if ENABLE_FLIGHTRECORDER
+void odometryOutputs()
+{
+	recorder.record(velocityControl, odometry);
+}
+#endif // ENABLE_FLIGHTRECORDER
+
+void velocityControlInputs()
+{
+	velocityControl.setInputs(odometry.getLinVel(), odometry.getAngVel());
+}
+
+#if ENABLE_FLIGHTRECORDER
+void velocityControlOutputs()
+{
+	if (!velocityControl.isEnabled()) // it just stopped the wheels because of an abnormal spin
+		recorder.trigger(FlightRecorder::SPIN_SHUTDOWN);
+}
+#endif // ENABLE_FLIGHTRECORDER
+
+void positionControlInputs()
+{
+	positionControl.setPosInput(odometry.getPosition());
+	positionControl.setVelInput(odometry.getLinVel(), odometry.getAngVel());
+}
+
+void positionControlOutputs()
+{
+	velocityControl.setSetpoints(positionControl.getLinVelSetpoint(), positionControl.getAngVelSetpoint());
+}
+
+// Instructions
+
+constexpr SerialTalks::Binding instructions[] PROGMEM =
+{
+	{SET_OPENLOOP_VELOCITIES_OPCODE,          SET_OPENLOOP_VELOCITIES},
+	{GET_CODEWHEELS_COUNTERS_OPCODE,          GET_CODEWHEELS_COUNTERS},
+	{SET_VELOCITIES_OPCODE,                   SET_VELOCITIES},
+	{RESET_PUREPURSUIT_OPCODE,                RESET_PUREPURSUIT},
+	{ADD_PUREPURSUIT_WAYPOINT_OPCODE,         ADD_PUREPURSUIT_WAYPOINT},
+	{START_PUREPURSUIT_OPCODE,                START_PUREPURSUIT},
+	{START_TURNONTHESPOT_OPCODE,              START_TURNONTHESPOT},
+	{POSITION_REACHED_OPCODE,                 POSITION_REACHED},
+	{SET_POSITION_OPCODE,                     SET_POSITION},
+	{GET_POSITION_OPCODE,                     GET_POSITION},
+	{GET_VELOCITIES_OPCODE,                   GET_VELOCITIES},
+	{SET_PARAMETER_VALUE_OPCODE,              SET_PARAMETER_VALUE},
+	{GET_PARAMETER_VALUE_OPCODE,              GET_PARAMETER_VALUE},
+	{SET_POSITION_COMPACT_OPCODE,             SET_POSITION_COMPACT},
+	{GET_POSITION_COMPACT_OPCODE,             GET_POSITION_COMPACT},
+	{SET_VELOCITIES_COMPACT_OPCODE,           SET_VELOCITIES_COMPACT},
+	{GET_VELOCITIES_COMPACT_OPCODE,           GET_VELOCITIES_COMPACT},
+	{ADD_PUREPURSUIT_WAYPOINT_COMPACT_OPCODE, ADD_PUREPURSUIT_WAYPOINT_COMPACT},
+	{START_PUREPURSUIT_STREAM_OPCODE,         START_PUREPURSUIT_STREAM},
+	{END_PUREPURSUIT_PATH_OPCODE,             END_PUREPURSUIT_PATH},
+	{PUREPURSUIT_LOW_WATERMARK_OPCODE,        PUREPURSUIT_LOW_WATERMARK},
+	{ADD_PUREPURSUIT_ARC_OPCODE,              ADD_PUREPURSUIT_ARC},
+	{ADD_PUREPURSUIT_BEZIER_OPCODE,           ADD_PUREPURSUIT_BEZIER},
+	{GET_SCHEDULER_STATISTICS_OPCODE,         GET_SCHEDULER_STATISTICS},
+#if ENABLE_PROFILER
+	{GET_PROFILE_OPCODE,                      GET_PROFILE},
+#endif // ENABLE_PROFILER
+#if ENABLE_FLIGHTRECORDER
+	{ARM_FLIGHTRECORDER_OPCODE,               ARM_FLIGHTRECORDER},
+	{TRIGGER_FLIGHTRECORDER_OPCODE,           TRIGGER_FLIGHTRECORDER},
+	{GET_FLIGHTRECORDER_STATUS_OPCODE,        GET_FLIGHTRECORDER_STATUS},
+	{GET_FLIGHTRECORDER_SAMPLES_OPCODE,       GET_FLIGHTRECORDER_SAMPLES},
+#endif // ENABLE_FLIGHTRECORDER
+};
+static_assert(SerialTalks::checkBindings(instructions), "instructions opcodes must be unique and not reserved");
+
 // Setup
 
 void setup()
@@ -47,19 +127,7 @@ void setup()
 	// Communication
 	Serial.begin(SERIALTALKS_BAUDRATE);
 	talks.begin(Serial);
-	talks.bind(SET_OPENLOOP_VELOCITIES_OPCODE, SET_OPENLOOP_VELOCITIES);
-	talks.bind(GET_CODEWHEELS_COUNTERS_OPCODE, GET_CODEWHEELS_COUNTERS);
-	talks.bind(SET_VELOCITIES_OPCODE, SET_VELOCITIES);
-	talks.bind(RESET_PUREPURSUIT_OPCODE, RESET_PUREPURSUIT);
-	talks.bind(ADD_PUREPURSUIT_WAYPOINT_OPCODE, ADD_PUREPURSUIT_WAYPOINT);
-	talks.bind(START_PUREPURSUIT_OPCODE, START_PUREPURSUIT);
-	talks.bind(START_TURNONTHESPOT_OPCODE, START_TURNONTHESPOT);
-	talks.bind(POSITION_REACHED_OPCODE, POSITION_REACHED);
-	talks.bind(SET_POSITION_OPCODE, SET_POSITION);
-	talks.bind(GET_POSITION_OPCODE, GET_POSITION);
-	talks.bind(GET_VELOCITIES_OPCODE, GET_VELOCITIES);
-	talks.bind(SET_PARAMETER_VALUE_OPCODE, SET_PARAMETER_VALUE);
-	talks.bind(GET_PARAMETER_VALUE_OPCODE, GET_PARAMETER_VALUE);
+	talks.bind(instructions);
 
 	// DC motors wheels
 	driver.attach(DRIVER_RESET, DRIVER_FAULT);
@@ -90,6 +158,7 @@ void setup()
 	velocityControl.load(VELOCITYCONTROL_ADDRESS);
 	velocityControl.setWheels(leftWheel, rightWheel);
 	velocityControl.setPID(linVelPID, angVelPID);
+	velocityControl.setTimestep(PID_CONTROLLERS_TIMESTEP);
 	velocityControl.disable();
 
 	const float maxLinVel = min(leftWheel.getMaxVelocity(), rightWheel.getMaxVelocity());
@@ -111,6 +180,34 @@ void setup()
 	positionControl.disable();
 
 	purePursuit.load(PUREPURSUIT_ADDRESS);
+	purePursuit.setVelocityController(velocityControl);
+
+#if ENABLE_FLIGHTRECORDER
+	// Keep the last moments before a spin shutdown until the host arms it otherwise
+	recorder.arm(FlightRecorder::SPIN_SHUTDOWN | FlightRecorder::HOST, FLIGHTRECORDER_MAX_SAMPLES / 4);
+#endif // ENABLE_FLIGHTRECORDER
+
+#if ENABLE_PROFILER
+	// Profiled sections, in the order of the GET_PROFILE indices, before the tasks start
+	profiler.attach(&odometry,        ODOMETRY_TIMESTEP);
+	profiler.attach(&velocityControl, PID_CONTROLLERS_TIMESTEP);
+	profiler.attach(&positionControl, POSITIONCONTROL_TIMESTEP);
+	profiler.attach(&talks);
+#endif // ENABLE_PROFILER
+
+	// Control tasks, from the most urgent to the least one
+#if ENABLE_FLIGHTRECORDER
+	scheduler.attach(odometry,        Scheduler::INTERRUPT, 0, odometryOutputs);
+	scheduler.attach(velocityControl, Scheduler::INTERRUPT, velocityControlInputs, velocityControlOutputs);
+#else
+	scheduler.attach(odometry,        Scheduler::INTERRUPT);
+	scheduler.attach(velocityControl, Scheduler::INTERRUPT, velocityControlInputs);
+#endif // ENABLE_FLIGHTRECORDER
+	scheduler.attach(positionControl, Scheduler::INTERRUPT, positionControlInputs, positionControlOutputs);
+#if ENABLE_VELOCITYCONTROLLER_LOGS
+	scheduler.attach(controllerLogs,  Scheduler::LOOP);
+#endif // ENABLE_VELOCITYCONTROLLER_LOGS
+	scheduler.begin();
 
 	// Miscellanous
 	TCCR2B = (TCCR2B & 0b11111000) | 1; // Set Timer2 frequency to 16MHz instead of 250kHz
@@ -120,28 +217,8 @@ void setup()
 
 void loop()
 {	
-	talks.execute();
-
-	// Update odometry
-	if (odometry.update())
-	{
-		positionControl.setPosInput(odometry.getPosition());
-		velocityControl.setInputs(odometry.getLinVel(), odometry.getAngVel());
-	}
-
-	// Compute trajectory
-	if (positionControl.update())
-	{
-		float linVelSetpoint = positionControl.getLinVelSetpoint();
-		float angVelSetpoint = positionControl.getAngVelSetpoint();
-		velocityControl.setSetpoints(linVelSetpoint, angVelSetpoint);
-	}
-
-	// Integrate engineering control
-#if ENABLE_VELOCITYCONTROLLER_LOGS
-	if (velocityControl.update())
-		controllerLogs.update();
-#else
-	velocityControl.update();
-#endif // ENABLE_VELOCITYCONTROLLER_LOGS
+	talks.execute(SERIALTALKS_EXECUTE_BUDGET);
+
+	// Odometry, engineering control and trajectory run from the Timer1 interrupt
+	scheduler.run();
 }
@@ -233,7 +233,7 @@ class SerialTalksProxy(Proxy):
 	def __init__(self, manager, uuid):
 		compid = manager.execute(CREATE_SERIALTALKS_COMPONENT_OPCODE, uuid)
 		attrlist = ['port', 'is_connected']
-		methlist = ['connect', 'disconnect', 'send', 'poll', 'flush', 'execute', 'getuuid', 'setuuid', 'getout', 'geterr']
+		methlist = ['connect', 'disconnect', 'send', 'poll', 'flush', 'execute', 'execute_batch', 'subscribe', 'unsubscribe', 'getuuid', 'setuuid', 'getout', 'geterr']
 		Proxy.__init__(self, manager, compid, attrlist, methlist)
 
 class SwitchProxy(Proxy):
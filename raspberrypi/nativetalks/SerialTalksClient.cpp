@@ -0,0 +1,431 @@
+#include "SerialTalksClient.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <chrono>
+#include <random>
+#include <set>
+#include <system_error>
+
+
+static std::set<SerialTalksClient*>& getRegisteredClients()
+{
+	static std::set<SerialTalksClient*> clients;
+	return clients;
+}
+
+static speed_t getSpeed(unsigned long baudrate)
+{
+	switch (baudrate)
+	{
+	case 9600:    return B9600;
+	case 19200:   return B19200;
+	case 38400:   return B38400;
+	case 57600:   return B57600;
+	case 115200:  return B115200;
+	case 230400:  return B230400;
+	case 460800:  return B460800;
+	case 500000:  return B500000;
+	case 1000000: return B1000000;
+	}
+	throw std::system_error(EINVAL, std::generic_category(), "unsupported baudrate");
+}
+
+
+// SerialTalksReactor
+
+SerialTalksReactor::SerialTalksReactor()
+{
+	m_epoll  = epoll_create1(EPOLL_CLOEXEC);
+	m_wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (m_epoll < 0 || m_wakeup < 0)
+		throw std::system_error(errno, std::generic_category(), "epoll");
+
+	epoll_event event = {};
+	event.events   = EPOLLIN;
+	event.data.ptr = 0;
+	epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &event);
+
+	m_thread = std::thread(&SerialTalksReactor::run, this);
+}
+
+SerialTalksReactor::~SerialTalksReactor()
+{
+	uint64_t one = 1;
+	if (::write(m_wakeup, &one, sizeof(one)) < 0){}
+	m_thread.join();
+	close(m_wakeup);
+	close(m_epoll);
+}
+
+SerialTalksReactor& SerialTalksReactor::getDefault()
+{
+	static SerialTalksReactor reactor;
+	return reactor;
+}
+
+void SerialTalksReactor::add(SerialTalksClient& client)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	epoll_event event = {};
+	event.events   = EPOLLIN;
+	event.data.ptr = &client;
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, client.m_fd, &event) < 0)
+		throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+	getRegisteredClients().insert(&client);
+}
+
+void SerialTalksReactor::remove(SerialTalksClient& client)
+{
+	// Once this returns, the reactor thread no longer uses the client
+	std::lock_guard<std::mutex> lock(m_mutex);
+	epoll_ctl(m_epoll, EPOLL_CTL_DEL, client.m_fd, 0);
+	getRegisteredClients().erase(&client);
+}
+
+void SerialTalksReactor::run()
+{
+	epoll_event events[16];
+	while (true)
+	{
+		int count = epoll_wait(m_epoll, events, 16, -1);
+		if (count < 0 && errno != EINTR)
+			break;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (int i = 0; i < count; i++)
+		{
+			SerialTalksClient* client = (SerialTalksClient*)(events[i].data.ptr);
+			if (client == 0)
+				return; // Woken up to stop
+
+			// The client may have been removed after epoll_wait returned
+			if (getRegisteredClients().count(client) > 0)
+				client->receive();
+		}
+	}
+}
+
+
+// SerialTalksFuture
+
+SerialTalksFuture::SerialTalksFuture(SerialTalksFuture&& other) : m_client(other.m_client), m_slot(other.m_slot), m_retcode(other.m_retcode)
+{
+	other.m_client = 0;
+}
+
+SerialTalksFuture& SerialTalksFuture::operator=(SerialTalksFuture&& other)
+{
+	if (this != &other)
+	{
+		release();
+		m_client  = other.m_client;
+		m_slot    = other.m_slot;
+		m_retcode = other.m_retcode;
+		other.m_client = 0;
+	}
+	return *this;
+}
+
+bool SerialTalksFuture::isReady() const
+{
+	if (m_client == 0)
+		return false;
+	std::lock_guard<std::mutex> lock(m_client->m_mutex);
+	return m_client->m_slots[m_slot].ready;
+}
+
+bool SerialTalksFuture::get(SerialTalksResponse& response, double timeout)
+{
+	if (m_client == 0)
+		return false;
+	SerialTalksClient::Slot& slot = m_client->m_slots[m_slot];
+	{
+		std::unique_lock<std::mutex> lock(m_client->m_mutex);
+		if (timeout < 0)
+			slot.cv.wait(lock, [&slot]{return slot.ready;});
+		else if (!slot.cv.wait_for(lock, std::chrono::duration<double>(timeout), [&slot]{return slot.ready;}))
+			return false;
+		response.size = slot.response.size;
+		memcpy(response.data, slot.response.data, slot.response.size);
+	}
+	release();
+	return true;
+}
+
+void SerialTalksFuture::resend()
+{
+	if (m_client == 0)
+		return;
+	SerialTalksClient::Slot& slot = m_client->m_slots[m_slot];
+	m_client->write(slot.frame, slot.frameSize);
+}
+
+void SerialTalksFuture::release()
+{
+	if (m_client != 0)
+	{
+		m_client->release(m_slot);
+		m_client = 0;
+	}
+}
+
+
+// SerialTalksClient
+
+SerialTalksClient::SerialTalksClient(const std::string& port, SerialTalksReactor& reactor) :
+	m_port(port), m_reactor(reactor), m_fd(-1), m_numFreeSlots(0), m_generation(std::random_device()()), m_state(WAITING_STATE)
+{
+	for (int i = SERIALTALKSCLIENT_MAX_PENDING - 1; i >= 0; i--)
+	{
+		m_slots[i].retcode = 0;
+		m_slots[i].busy    = false;
+		m_slots[i].ready   = false;
+		m_freeSlots[m_numFreeSlots++] = i;
+	}
+}
+
+SerialTalksClient::~SerialTalksClient()
+{
+	disconnect();
+}
+
+bool SerialTalksClient::connect(double timeout, unsigned long baudrate)
+{
+	if (isConnected())
+		return true;
+
+	// Open the serial port in raw mode
+	int fd = open(m_port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0)
+		throw std::system_error(errno, std::generic_category(), m_port);
+	termios tty;
+	if (tcgetattr(fd, &tty) == 0)
+	{
+		cfmakeraw(&tty);
+		cfsetispeed(&tty, getSpeed(baudrate));
+		cfsetospeed(&tty, getSpeed(baudrate));
+		tty.c_cflag |= CLOCAL | CREAD;
+		tcsetattr(fd, TCSANOW, &tty);
+	}
+	m_state = WAITING_STATE;
+	m_fd = fd;
+	m_reactor.add(*this);
+
+	// Wait until the Arduino is operational
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	SerialTalksResponse response;
+	do
+	{
+		if (execute(SERIALTALKSCLIENT_PING_OPCODE, 0, 0, response, 0.1))
+			return true;
+	}
+	while (std::chrono::steady_clock::now() - start < std::chrono::duration<double>(timeout));
+	disconnect();
+	return false;
+}
+
+void SerialTalksClient::disconnect()
+{
+	if (!isConnected())
+		return;
+	m_reactor.remove(*this);
+	std::lock_guard<std::mutex> lock(m_writeMutex);
+	close(m_fd);
+	m_fd = -1;
+}
+
+void SerialTalksClient::setHandler(const Handler& handler)
+{
+	m_handler = handler;
+}
+
+void SerialTalksClient::write(const uint8_t* buffer, size_t size)
+{
+	std::lock_guard<std::mutex> lock(m_writeMutex);
+	if (m_fd < 0)
+		throw std::system_error(ENOTCONN, std::generic_category(), m_port);
+	while (size > 0)
+	{
+		ssize_t count = ::write(m_fd, buffer, size);
+		if (count < 0)
+		{
+			if (errno == EAGAIN)
+			{
+				pollfd pfd = {m_fd, POLLOUT, 0};
+				poll(&pfd, 1, -1);
+				continue;
+			}
+			if (errno == EINTR)
+				continue;
+			throw std::system_error(errno, std::generic_category(), m_port);
+		}
+		buffer += count;
+		size   -= count;
+	}
+}
+
+static void checkSize(size_t size)
+{
+	if (1 + sizeof(uint32_t) + size > SERIALTALKSCLIENT_INPUT_BUFFER_SIZE)
+		throw std::system_error(EMSGSIZE, std::generic_category(), "instruction too long");
+}
+
+static size_t makeFrame(uint8_t* frame, uint8_t opcode, uint32_t retcode, const void* args, size_t size)
+{
+	checkSize(size);
+	frame[0] = SERIALTALKSCLIENT_MASTER_BYTE;
+	frame[1] = uint8_t(1 + sizeof(retcode) + size);
+	frame[2] = opcode;
+	for (size_t i = 0; i < sizeof(retcode); i++)
+		frame[3 + i] = uint8_t(retcode >> (8 * i));
+	if (size > 0)
+		memcpy(frame + 3 + sizeof(retcode), args, size);
+	return 2 + frame[1];
+}
+
+SerialTalksFuture SerialTalksClient::submit(uint8_t opcode, const void* args, size_t size)
+{
+	checkSize(size); // before taking a slot
+
+	int index;
+	uint32_t retcode;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_freeSlotCV.wait(lock, [this]{return m_numFreeSlots > 0;});
+		index = m_freeSlots[--m_numFreeSlots];
+		retcode = makeRetcode(index);
+
+		Slot& slot = m_slots[index];
+		slot.retcode   = retcode;
+		slot.busy      = true;
+		slot.ready     = false;
+		slot.frameSize = makeFrame(slot.frame, opcode, retcode, args, size);
+	}
+	SerialTalksFuture future(this, index, retcode);
+	write(m_slots[index].frame, m_slots[index].frameSize);
+	return future;
+}
+
+uint32_t SerialTalksClient::send(uint8_t opcode, const void* args, size_t size)
+{
+	// No slot has this index, so the response, if any, goes to the handler
+	uint32_t retcode;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		retcode = makeRetcode(0xFF);
+	}
+	send(opcode, args, size, retcode);
+	return retcode;
+}
+
+void SerialTalksClient::send(uint8_t opcode, const void* args, size_t size, uint32_t retcode)
+{
+	uint8_t frame[2 + SERIALTALKSCLIENT_INPUT_BUFFER_SIZE];
+	write(frame, makeFrame(frame, opcode, retcode, args, size));
+}
+
+bool SerialTalksClient::execute(uint8_t opcode, const void* args, size_t size, SerialTalksResponse& response, double timeout, int retries)
+{
+	SerialTalksFuture future = submit(opcode, args, size);
+	for (int attempt = 0; attempt < retries; attempt++)
+	{
+		if (future.get(response, timeout))
+			return true;
+		future.resend();
+	}
+	return future.get(response, timeout);
+}
+
+bool SerialTalksClient::getUUID(std::string& uuid, double timeout)
+{
+	SerialTalksResponse response;
+	if (!execute(SERIALTALKSCLIENT_GETUUID_OPCODE, 0, 0, response, timeout))
+		return false;
+	uuid.assign((const char*)(response.data), strnlen((const char*)(response.data), response.size));
+	return true;
+}
+
+uint32_t SerialTalksClient::makeRetcode(int index)
+{
+	// Keep the highest bit clear so that retcodes never collide with the logs ones
+	m_generation = (m_generation + 1) & 0x7FFFFF;
+	return (m_generation << 8) | uint32_t(index);
+}
+
+void SerialTalksClient::release(int index)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Slot& slot = m_slots[index];
+	slot.busy  = false;
+	slot.ready = false;
+	m_freeSlots[m_numFreeSlots++] = index;
+	m_freeSlotCV.notify_one();
+}
+
+void SerialTalksClient::receive()
+{
+	uint8_t buffer[256];
+	ssize_t length = read(m_fd, buffer, sizeof(buffer));
+	for (ssize_t i = 0; i < length; i++)
+	{
+		uint8_t inc = buffer[i];
+		switch (m_state)
+		{
+		case WAITING_STATE:
+			if (inc == SERIALTALKSCLIENT_SLAVE_BYTE)
+				m_state = STARTING_STATE;
+			break;
+
+		case STARTING_STATE:
+			m_bytesNumber  = inc;
+			m_bytesCounter = 0;
+			m_state = (m_bytesNumber >= sizeof(uint32_t)) ? RECEIVING_STATE : WAITING_STATE;
+			break;
+
+		case RECEIVING_STATE:
+			m_inputBuffer[m_bytesCounter++] = inc;
+			if (m_bytesCounter >= m_bytesNumber)
+			{
+				uint32_t retcode = 0;
+				for (size_t j = 0; j < sizeof(retcode); j++)
+					retcode |= uint32_t(m_inputBuffer[j]) << (8 * j);
+				dispatch(retcode, m_inputBuffer + sizeof(retcode), m_bytesNumber - sizeof(retcode));
+				m_state = WAITING_STATE;
+			}
+			break;
+		}
+	}
+}
+
+void SerialTalksClient::dispatch(uint32_t retcode, const uint8_t* data, size_t size)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	int index = retcode & 0xFF;
+	if (index < SERIALTALKSCLIENT_MAX_PENDING)
+	{
+		Slot& slot = m_slots[index];
+		if (slot.busy && slot.retcode == retcode)
+		{
+			// A replayed response may come after the original one: keep the first
+			if (!slot.ready)
+			{
+				memcpy(slot.response.data, data, size);
+				slot.response.size = uint8_t(size);
+				slot.ready = true;
+				slot.cv.notify_all();
+			}
+			return;
+		}
+	}
+	lock.unlock();
+	if (m_handler)
+		m_handler(retcode, data, size);
+}
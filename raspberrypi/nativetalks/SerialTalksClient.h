@@ -0,0 +1,206 @@
+#ifndef __SERIALTALKSCLIENT_H__
+#define __SERIALTALKSCLIENT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Host side of the SerialTalks protocol (see arduino/common/SerialTalks.h).
+//
+// Frames are 'R', length, opcode, retcode and arguments from the host to the board, and 'A',
+// length, retcode and output the other way round. Everything is little-endian and sized after the
+// AVR data model: an Arduino `long` is an `int32_t` here and an Arduino `int` is an `int16_t`.
+
+#define SERIALTALKSCLIENT_BAUDRATE 19200
+
+#define SERIALTALKSCLIENT_MASTER_BYTE 'R'
+#define SERIALTALKSCLIENT_SLAVE_BYTE  'A'
+
+#define SERIALTALKSCLIENT_PING_OPCODE    0x0
+#define SERIALTALKSCLIENT_GETUUID_OPCODE 0x1
+
+#define SERIALTALKSCLIENT_INPUT_BUFFER_SIZE 64 // The board doesn't take longer frames
+
+#define SERIALTALKSCLIENT_MAX_PENDING 64 // Number of requests in flight per board (at most 256)
+
+
+class SerialTalksClient;
+
+// One thread waits for the incoming bytes of every opened board with epoll and dispatches the
+// responses to the pending requests.
+
+class SerialTalksReactor
+{
+public:
+
+	SerialTalksReactor();
+	~SerialTalksReactor();
+
+	static SerialTalksReactor& getDefault();
+
+	void add   (SerialTalksClient& client);
+	void remove(SerialTalksClient& client);
+
+protected:
+
+	void run();
+
+	int         m_epoll;
+	int         m_wakeup; // eventfd used to stop the thread
+	std::thread m_thread;
+	std::mutex  m_mutex;  // held while dispatching, so that clients can't vanish meanwhile
+};
+
+
+// Response of a request: the output of the instruction
+
+struct SerialTalksResponse
+{
+	uint8_t size;
+	uint8_t data[255];
+};
+
+
+// Handle to a request in flight. It is valid until its response is read or it is destroyed.
+
+class SerialTalksFuture
+{
+public:
+
+	SerialTalksFuture() : m_client(0), m_slot(0), m_retcode(0){}
+	SerialTalksFuture(SerialTalksFuture&& other);
+	SerialTalksFuture& operator=(SerialTalksFuture&& other);
+	~SerialTalksFuture(){release();}
+
+	SerialTalksFuture(const SerialTalksFuture&) = delete;
+	SerialTalksFuture& operator=(const SerialTalksFuture&) = delete;
+
+	bool isValid() const {return m_client != 0;}
+	bool isReady() const;
+
+	uint32_t getRetcode() const {return m_retcode;}
+
+	// Wait for the response and release the request. Return false on timeout (in seconds, negative
+	// to wait forever), in which case the request is still pending.
+	bool get(SerialTalksResponse& response, double timeout = -1);
+
+	// Send the request again with the same retcode: the board replays its response if it already
+	// executed it.
+	void resend();
+
+	void release();
+
+protected:
+
+	friend class SerialTalksClient;
+
+	SerialTalksFuture(SerialTalksClient* client, int slot, uint32_t retcode) : m_client(client), m_slot(slot), m_retcode(retcode){}
+
+	SerialTalksClient* m_client;
+	int                m_slot;
+	uint32_t           m_retcode;
+};
+
+
+class SerialTalksClient
+{
+public:
+
+	// Called from the reactor thread for the frames that answer no pending request: logs,
+	// subscriptions pushes or late responses. It must be set before connecting.
+	typedef std::function<void(uint32_t retcode, const uint8_t* data, size_t size)> Handler;
+
+	SerialTalksClient(const std::string& port, SerialTalksReactor& reactor = SerialTalksReactor::getDefault());
+	~SerialTalksClient();
+
+	// Open the serial port and wait for the board to answer a ping. Throw std::system_error if the
+	// port can't be opened and return false if the board is mute.
+	bool connect(double timeout = 5, unsigned long baudrate = SERIALTALKSCLIENT_BAUDRATE);
+	void disconnect();
+
+	bool isConnected() const {return m_fd >= 0;}
+
+	const std::string& getPort() const {return m_port;}
+
+	void setHandler(const Handler& handler);
+
+	// Send a request and return a handle to its response. This blocks if too many requests are
+	// already in flight.
+	SerialTalksFuture submit(uint8_t opcode, const void* args = 0, size_t size = 0);
+
+	// Send a request whose response is not expected and return its retcode. It is a fresh one as
+	// for the submitted requests, otherwise the board would take the request for a retransmission
+	// of the previous one and replay its response instead of executing it.
+	uint32_t send(uint8_t opcode, const void* args = 0, size_t size = 0);
+
+	// Send a request again with the retcode `send` returned
+	void send(uint8_t opcode, const void* args, size_t size, uint32_t retcode);
+
+	// Submit a request and wait for its response, sending it again up to `retries` times
+	bool execute(uint8_t opcode, const void* args, size_t size, SerialTalksResponse& response, double timeout = 5, int retries = 0);
+
+	bool getUUID(std::string& uuid, double timeout = 5);
+
+protected:
+
+	friend class SerialTalksReactor;
+	friend class SerialTalksFuture;
+
+	void write(const uint8_t* buffer, size_t size);
+
+	void receive(); // Called by the reactor when bytes are available
+	void dispatch(uint32_t retcode, const uint8_t* data, size_t size);
+
+	void release(int slot);
+
+	uint32_t makeRetcode(int slot); // Called with m_mutex held
+
+	// Each request in flight takes a slot. Its retcode is the slot index in the lowest byte and a
+	// generation counter in the others, so that a response finds its request in constant time and
+	// a late response to a released slot is recognized as such. The counter starts at random so
+	// that a restarted host doesn't reuse the retcodes the board has just seen.
+	struct Slot
+	{
+		uint32_t            retcode;
+		bool                busy;
+		bool                ready;
+		uint8_t             frameSize;
+		uint8_t             frame[2 + SERIALTALKSCLIENT_INPUT_BUFFER_SIZE]; // kept for resending
+		SerialTalksResponse response;
+		std::condition_variable cv;
+	};
+
+	std::string         m_port;
+	SerialTalksReactor& m_reactor;
+	std::atomic<int>    m_fd;
+
+	std::mutex          m_writeMutex;
+
+	std::mutex          m_mutex; // protects the slots
+	std::condition_variable m_freeSlotCV;
+	Slot                m_slots[SERIALTALKSCLIENT_MAX_PENDING];
+	int                 m_freeSlots[SERIALTALKSCLIENT_MAX_PENDING];
+	int                 m_numFreeSlots;
+	uint32_t            m_generation;
+
+	Handler             m_handler;
+
+	// Incoming frames state machine (only used by the reactor thread)
+	enum
+	{
+		WAITING_STATE,
+		STARTING_STATE,
+		RECEIVING_STATE,
+	}                   m_state;
+	uint8_t             m_bytesNumber;
+	uint8_t             m_bytesCounter;
+	uint8_t             m_inputBuffer[255];
+};
+
+#endif // __SERIALTALKSCLIENT_H__
@@ -0,0 +1,71 @@
+#!/usr/bin/python3
+#-*- coding: utf-8 -*-
+
+# Same interface as `serialtalks.SerialTalks`, but the I/O and the responses dispatching are done
+# by the native client library (see SerialTalksClient.h). Build it first:
+#
+#     cmake -S raspberrypi/nativetalks -B build && cmake --build build
+#
+# which puts the `_nativetalks` extension module in this directory.
+
+from serialtalks import Deserializer, MuteError, BAUDRATE, STDOUT_RETCODE, STDERR_RETCODE
+from ._nativetalks import Client, Future
+
+
+class NativeSerialTalks:
+
+	def __init__(self, port):
+		self.port = port
+		self.client = Client(port)
+		self.logs = {STDOUT_RETCODE: [], STDERR_RETCODE: []}
+		self.client.set_handler(self.process)
+
+	def __enter__(self):
+		self.connect()
+		return self
+
+	def __exit__(self, exc_type, exc_value, traceback):
+		self.disconnect()
+
+	@property
+	def is_connected(self):
+		return self.client.is_connected()
+
+	def connect(self, timeout=5, baudrate=BAUDRATE):
+		try:
+			self.client.connect(timeout, baudrate)
+		except TimeoutError:
+			raise MuteError('\'{}\' is mute. It may not be an Arduino or it\'s sketch may not be correctly loaded.'.format(self.port)) from None
+
+	def disconnect(self):
+		self.client.disconnect()
+
+	def process(self, retcode, content):
+		# Called from the reactor thread with the frames that answer no request
+		if retcode in self.logs:
+			self.logs[retcode].append(content)
+
+	def send(self, opcode, *args, retcode=None):
+		# Like `serialtalks.SerialTalks.send`, a fresh retcode is taken unless one is given
+		return self.client.send(opcode, bytes().join(args), retcode)
+
+	def submit(self, opcode, *args):
+		# Return a Future whose `result(timeout)` is the raw content of the response
+		return self.client.submit(opcode, bytes().join(args))
+
+	def execute(self, opcode, *args, timeout=5, retries=0):
+		return Deserializer(self.client.execute(opcode, bytes().join(args), timeout, retries))
+
+	def getuuid(self, timeout=5):
+		return self.client.getuuid(timeout)
+
+	def getlog(self, retcode):
+		log = bytes().join(self.logs[retcode])
+		self.logs[retcode].clear()
+		return log.replace(b'\0', b'').decode('utf-8', errors='replace')
+
+	def getout(self):
+		return self.getlog(STDOUT_RETCODE)
+
+	def geterr(self):
+		return self.getlog(STDERR_RETCODE)
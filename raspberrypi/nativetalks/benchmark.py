@@ -0,0 +1,75 @@
+#!/usr/bin/python3
+#-*- coding: utf-8 -*-
+
+# Compare the round trip times of serialtalks.py and of the native client library against the
+# `loopback` fake board, which answers on a pseudo-terminal as fast as it can:
+#
+#     ./benchmark.py build/loopback
+
+import os
+import sys
+import time
+import argparse
+import subprocess
+import statistics
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+
+from serialtalks import SerialTalks, FLOAT
+from nativetalks import NativeSerialTalks
+
+OPCODE = 0x0B
+ARGS   = (FLOAT(1), FLOAT(2), FLOAT(3)) # Same size as a GET_POSITION output
+
+
+def sequential(talks, count):
+	latencies = []
+	for i in range(count):
+		start = time.perf_counter()
+		talks.execute(OPCODE, *ARGS, timeout=1)
+		latencies.append(time.perf_counter() - start)
+	return latencies
+
+def pipelined_python(talks, count):
+	start = time.perf_counter()
+	retcodes = [talks.send(OPCODE, *ARGS) for i in range(count)]
+	for retcode in retcodes:
+		talks.poll(retcode, timeout=1)
+	return time.perf_counter() - start
+
+def pipelined_native(talks, count):
+	start = time.perf_counter()
+	futures = [talks.submit(OPCODE, *ARGS) for i in range(count)]
+	for future in futures:
+		future.result(timeout=1)
+	return time.perf_counter() - start
+
+def report(name, latencies, duration, count):
+	latencies = sorted(latencies)
+	percentile = lambda p: latencies[min(len(latencies) - 1, int(p * len(latencies)))] * 1e6
+	print('{:<12} {:>9.1f} {:>9.1f} {:>9.1f} {:>9.1f} {:>12.0f}'.format(name,
+		statistics.mean(latencies) * 1e6, percentile(0.5), percentile(0.99), latencies[-1] * 1e6,
+		count / duration))
+
+
+if __name__ == '__main__':
+	parser = argparse.ArgumentParser(description='SerialTalks clients benchmark')
+	parser.add_argument('loopback', help='path to the loopback executable')
+	parser.add_argument('-n', '--count', type=int, default=2000, help='number of requests')
+	parser.add_argument('-p', '--pipeline', type=int, default=32, help='requests in flight')
+	args = parser.parse_args()
+
+	board = subprocess.Popen([args.loopback], stdout=subprocess.PIPE)
+	port  = board.stdout.readline().decode().strip()
+	try:
+		print('{:<12} {:>9} {:>9} {:>9} {:>9} {:>12}'.format('client', 'mean(us)', 'p50(us)', 'p99(us)', 'max(us)', 'pipelined/s'))
+		for name, cls, pipelined in (('serialtalks', SerialTalks, pipelined_python), ('native', NativeSerialTalks, pipelined_native)):
+			talks = cls(port)
+			talks.connect()
+			sequential(talks, 100) # Warm up
+			latencies = sequential(talks, args.count)
+			duration = sum(pipelined(talks, args.pipeline) for i in range(args.count // args.pipeline))
+			report(name, latencies, duration, args.pipeline * (args.count // args.pipeline))
+			talks.disconnect()
+	finally:
+		board.kill()
@@ -0,0 +1,68 @@
+// Fake board for benchmarks: it opens a pseudo-terminal, prints its name and answers every
+// SerialTalks instruction with its own arguments. It is as fast as a board can be, so the
+// measured round trips are the host overhead only.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <stdint.h>
+
+int main()
+{
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0)
+	{
+		perror("posix_openpt");
+		return 1;
+	}
+	termios tty;
+	tcgetattr(fd, &tty);
+	cfmakeraw(&tty);
+	tcsetattr(fd, TCSANOW, &tty);
+	printf("%s\n", ptsname(fd));
+	fflush(stdout);
+
+	enum {WAITING, STARTING, RECEIVING} state = WAITING;
+	uint8_t frame[2 + 255] = {'A'};
+	uint8_t length  = 0;
+	uint8_t counter = 0;
+	uint8_t buffer[256];
+	while (true)
+	{
+		ssize_t count = read(fd, buffer, sizeof(buffer));
+		if (count < 0)
+			continue; // No one opened the other end yet
+		for (ssize_t i = 0; i < count; i++)
+		{
+			uint8_t inc = buffer[i];
+			switch (state)
+			{
+			case WAITING:
+				if (inc == 'R')
+					state = STARTING;
+				break;
+			case STARTING:
+				length  = inc;
+				counter = 0;
+				state   = (length >= 5) ? RECEIVING : WAITING;
+				break;
+			case RECEIVING:
+				// Drop the opcode and keep the retcode and the arguments
+				if (counter++ > 0)
+					frame[counter] = inc;
+				if (counter >= length)
+				{
+					frame[1] = length - 1;
+					if (write(fd, frame, 2 + frame[1]) < 0)
+						return 1;
+					state = WAITING;
+				}
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,365 @@
+// Python bindings of SerialTalksClient: the `_nativetalks` module. The `nativetalks` package wraps
+// it with the same interface as `serialtalks.SerialTalks`.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "SerialTalksClient.h"
+
+#include <new>
+#include <system_error>
+
+
+// Release the GIL in a scope, even if an exception is thrown
+
+class AllowThreads
+{
+public:
+
+	AllowThreads() : m_state(PyEval_SaveThread()){}
+	~AllowThreads(){PyEval_RestoreThread(m_state);}
+
+private:
+
+	PyThreadState* m_state;
+};
+
+static PyObject* raise(const std::system_error& e)
+{
+	PyObject* args = Py_BuildValue("(is)", e.code().value(), e.what());
+	PyErr_SetObject(PyExc_OSError, args);
+	Py_XDECREF(args);
+	return 0;
+}
+
+
+// Future
+
+struct FutureObject
+{
+	PyObject_HEAD
+	SerialTalksFuture future;
+	PyObject*         client; // Keep the client alive as long as its requests
+};
+
+static void Future_dealloc(FutureObject* self)
+{
+	self->future.~SerialTalksFuture();
+	Py_XDECREF(self->client);
+	Py_TYPE(self)->tp_free((PyObject*)(self));
+}
+
+static PyObject* Future_result(FutureObject* self, PyObject* args, PyObject* kwargs)
+{
+	static const char* keywords[] = {"timeout", 0};
+	PyObject* timeoutObject = Py_None;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", (char**)(keywords), &timeoutObject))
+		return 0;
+	double timeout = (timeoutObject == Py_None) ? -1 : PyFloat_AsDouble(timeoutObject);
+	if (PyErr_Occurred())
+		return 0;
+	if (!self->future.isValid())
+	{
+		PyErr_SetString(PyExc_RuntimeError, "the result was already read");
+		return 0;
+	}
+	SerialTalksResponse response;
+	bool ready;
+	Py_BEGIN_ALLOW_THREADS
+	ready = self->future.get(response, timeout);
+	Py_END_ALLOW_THREADS
+	if (!ready)
+	{
+		PyErr_SetString(PyExc_TimeoutError, "timeout exceeded");
+		return 0;
+	}
+	return PyBytes_FromStringAndSize((const char*)(response.data), response.size);
+}
+
+static PyObject* Future_done(FutureObject* self, PyObject*)
+{
+	return PyBool_FromLong(self->future.isReady());
+}
+
+static PyObject* Future_resend(FutureObject* self, PyObject*)
+{
+	try
+	{
+		AllowThreads threads;
+		self->future.resend();
+	}
+	catch (const std::system_error& e){return raise(e);}
+	Py_RETURN_NONE;
+}
+
+static PyObject* Future_getretcode(FutureObject* self, void*)
+{
+	return PyLong_FromUnsignedLong(self->future.getRetcode());
+}
+
+static PyMethodDef Future_methods[] =
+{
+	{"result", (PyCFunction)(void(*)(void))(Future_result), METH_VARARGS | METH_KEYWORDS, "Wait for the response and return its content."},
+	{"done",   (PyCFunction)(Future_done),   METH_NOARGS, "Tell whether the response arrived."},
+	{"resend", (PyCFunction)(Future_resend), METH_NOARGS, "Send the request again with the same retcode."},
+	{0}
+};
+
+static PyGetSetDef Future_getset[] =
+{
+	{"retcode", (getter)(Future_getretcode), 0, "Retcode of the request.", 0},
+	{0}
+};
+
+static PyTypeObject FutureType = {PyVarObject_HEAD_INIT(0, 0)};
+
+
+// Client
+
+struct ClientObject
+{
+	PyObject_HEAD
+	SerialTalksClient* client;
+	PyObject*          handler;
+};
+
+static PyObject* Client_new(PyTypeObject* type, PyObject* args, PyObject* kwargs)
+{
+	static const char* keywords[] = {"port", 0};
+	const char* port;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char**)(keywords), &port))
+		return 0;
+	ClientObject* self = (ClientObject*)(type->tp_alloc(type, 0));
+	if (self == 0)
+		return 0;
+	self->client  = new SerialTalksClient(port);
+	self->handler = 0;
+	return (PyObject*)(self);
+}
+
+static void Client_dealloc(ClientObject* self)
+{
+	Py_BEGIN_ALLOW_THREADS
+	delete self->client;
+	Py_END_ALLOW_THREADS
+	Py_XDECREF(self->handler);
+	Py_TYPE(self)->tp_free((PyObject*)(self));
+}
+
+static PyObject* Client_connect(ClientObject* self, PyObject* args, PyObject* kwargs)
+{
+	static const char* keywords[] = {"timeout", "baudrate", 0};
+	double timeout = 5;
+	unsigned long baudrate = SERIALTALKSCLIENT_BAUDRATE;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|dk", (char**)(keywords), &timeout, &baudrate))
+		return 0;
+	bool connected;
+	try
+	{
+		AllowThreads threads;
+		connected = self->client->connect(timeout, baudrate);
+	}
+	catch (const std::system_error& e){return raise(e);}
+	if (!connected)
+	{
+		PyErr_Format(PyExc_TimeoutError, "'%s' is mute", self->client->getPort().c_str());
+		return 0;
+	}
+	Py_RETURN_NONE;
+}
+
+static PyObject* Client_disconnect(ClientObject* self, PyObject*)
+{
+	Py_BEGIN_ALLOW_THREADS
+	self->client->disconnect();
+	Py_END_ALLOW_THREADS
+	Py_RETURN_NONE;
+}
+
+static PyObject* Client_isconnected(ClientObject* self, PyObject*)
+{
+	return PyBool_FromLong(self->client->isConnected());
+}
+
+static PyObject* Client_send(ClientObject* self, PyObject* args, PyObject* kwargs)
+{
+	static const char* keywords[] = {"opcode", "args", "retcode", 0};
+	unsigned char opcode;
+	Py_buffer buffer = {0};
+	PyObject* retcodeObject = Py_None; // A fresh retcode is taken if none is given
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "b|y*O", (char**)(keywords), &opcode, &buffer, &retcodeObject))
+		return 0;
+	unsigned long retcode = 0;
+	if (retcodeObject != Py_None)
+	{
+		retcode = PyLong_AsUnsignedLong(retcodeObject);
+		if (PyErr_Occurred())
+		{
+			PyBuffer_Release(&buffer);
+			return 0;
+		}
+	}
+	try
+	{
+		AllowThreads threads;
+		if (retcodeObject != Py_None)
+			self->client->send(opcode, buffer.buf, buffer.len, retcode);
+		else
+			retcode = self->client->send(opcode, buffer.buf, buffer.len);
+	}
+	catch (const std::system_error& e){PyBuffer_Release(&buffer); return raise(e);}
+	PyBuffer_Release(&buffer);
+	return PyLong_FromUnsignedLong(retcode);
+}
+
+static PyObject* Client_submit(ClientObject* self, PyObject* args, PyObject* kwargs)
+{
+	static const char* keywords[] = {"opcode", "args", 0};
+	unsigned char opcode;
+	Py_buffer buffer = {0};
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "b|y*", (char**)(keywords), &opcode, &buffer))
+		return 0;
+	FutureObject* future = (FutureObject*)(FutureType.tp_alloc(&FutureType, 0));
+	if (future == 0)
+	{
+		PyBuffer_Release(&buffer);
+		return 0;
+	}
+	new (&future->future) SerialTalksFuture();
+	future->client = (PyObject*)(self);
+	Py_INCREF(self);
+	try
+	{
+		AllowThreads threads;
+		future->future = self->client->submit(opcode, buffer.buf, buffer.len);
+	}
+	catch (const std::system_error& e){PyBuffer_Release(&buffer); Py_DECREF(future); return raise(e);}
+	PyBuffer_Release(&buffer);
+	return (PyObject*)(future);
+}
+
+static PyObject* Client_execute(ClientObject* self, PyObject* args, PyObject* kwargs)
+{
+	static const char* keywords[] = {"opcode", "args", "timeout", "retries", 0};
+	unsigned char opcode;
+	Py_buffer buffer = {0};
+	double timeout = 5;
+	int retries = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "b|y*di", (char**)(keywords), &opcode, &buffer, &timeout, &retries))
+		return 0;
+	SerialTalksResponse response;
+	bool ready;
+	try
+	{
+		AllowThreads threads;
+		ready = self->client->execute(opcode, buffer.buf, buffer.len, response, timeout, retries);
+	}
+	catch (const std::system_error& e){PyBuffer_Release(&buffer); return raise(e);}
+	PyBuffer_Release(&buffer);
+	if (!ready)
+	{
+		PyErr_SetString(PyExc_TimeoutError, "timeout exceeded");
+		return 0;
+	}
+	return PyBytes_FromStringAndSize((const char*)(response.data), response.size);
+}
+
+static PyObject* Client_getuuid(ClientObject* self, PyObject* args, PyObject* kwargs)
+{
+	static const char* keywords[] = {"timeout", 0};
+	double timeout = 5;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|d", (char**)(keywords), &timeout))
+		return 0;
+	std::string uuid;
+	bool ready;
+	try
+	{
+		AllowThreads threads;
+		ready = self->client->getUUID(uuid, timeout);
+	}
+	catch (const std::system_error& e){return raise(e);}
+	if (!ready)
+	{
+		PyErr_SetString(PyExc_TimeoutError, "timeout exceeded");
+		return 0;
+	}
+	return PyUnicode_DecodeUTF8(uuid.data(), uuid.size(), "replace");
+}
+
+static PyObject* Client_sethandler(ClientObject* self, PyObject* handler)
+{
+	// The handler is called from the reactor thread with the retcode and the content of the frames
+	// that answer no request
+	if (self->client->isConnected())
+	{
+		PyErr_SetString(PyExc_RuntimeError, "the handler must be set before connecting");
+		return 0;
+	}
+	Py_XDECREF(self->handler);
+	self->handler = (handler != Py_None) ? handler : 0;
+	Py_XINCREF(self->handler);
+	if (self->handler == 0)
+	{
+		self->client->setHandler(SerialTalksClient::Handler());
+		Py_RETURN_NONE;
+	}
+	self->client->setHandler([self](uint32_t retcode, const uint8_t* data, size_t size)
+	{
+		PyGILState_STATE state = PyGILState_Ensure();
+		PyObject* result = PyObject_CallFunction(self->handler, "ky#", (unsigned long)(retcode), (const char*)(data), (Py_ssize_t)(size));
+		if (result == 0)
+			PyErr_Print();
+		Py_XDECREF(result);
+		PyGILState_Release(state);
+	});
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef Client_methods[] =
+{
+	{"connect",      (PyCFunction)(void(*)(void))(Client_connect), METH_VARARGS | METH_KEYWORDS, "Open the serial port and wait for the board."},
+	{"disconnect",   (PyCFunction)(Client_disconnect),  METH_NOARGS, "Close the serial port."},
+	{"is_connected", (PyCFunction)(Client_isconnected), METH_NOARGS, "Tell whether the serial port is opened."},
+	{"send",         (PyCFunction)(void(*)(void))(Client_send),    METH_VARARGS | METH_KEYWORDS, "Send an instruction without waiting for its response and return its retcode."},
+	{"submit",       (PyCFunction)(void(*)(void))(Client_submit),  METH_VARARGS | METH_KEYWORDS, "Send an instruction and return a Future of its response."},
+	{"execute",      (PyCFunction)(void(*)(void))(Client_execute), METH_VARARGS | METH_KEYWORDS, "Send an instruction and return its response."},
+	{"getuuid",      (PyCFunction)(void(*)(void))(Client_getuuid), METH_VARARGS | METH_KEYWORDS, "Return the board UUID."},
+	{"set_handler",  (PyCFunction)(Client_sethandler),  METH_O, "Set the callback of the unrequested frames."},
+	{0}
+};
+
+static PyTypeObject ClientType = {PyVarObject_HEAD_INIT(0, 0)};
+
+
+// Module
+
+static PyModuleDef nativetalksModule = {PyModuleDef_HEAD_INIT, "_nativetalks", "Native SerialTalks client.", -1};
+
+PyMODINIT_FUNC PyInit__nativetalks()
+{
+	FutureType.tp_name      = "_nativetalks.Future";
+	FutureType.tp_basicsize = sizeof(FutureObject);
+	FutureType.tp_flags     = Py_TPFLAGS_DEFAULT;
+	FutureType.tp_dealloc   = (destructor)(Future_dealloc);
+	FutureType.tp_methods   = Future_methods;
+	FutureType.tp_getset    = Future_getset;
+
+	ClientType.tp_name      = "_nativetalks.Client";
+	ClientType.tp_basicsize = sizeof(ClientObject);
+	ClientType.tp_flags     = Py_TPFLAGS_DEFAULT;
+	ClientType.tp_new       = Client_new;
+	ClientType.tp_dealloc   = (destructor)(Client_dealloc);
+	ClientType.tp_methods   = Client_methods;
+
+	if (PyType_Ready(&FutureType) < 0 || PyType_Ready(&ClientType) < 0)
+		return 0;
+
+	PyObject* module = PyModule_Create(&nativetalksModule);
+	if (module == 0)
+		return 0;
+	Py_INCREF(&FutureType);
+	Py_INCREF(&ClientType);
+	PyModule_AddObject(module, "Future", (PyObject*)(&FutureType));
+	PyModule_AddObject(module, "Client", (PyObject*)(&ClientType));
+	return module;
+}
@@ -0,0 +1,59 @@
+#!/usr/bin/python3
+#-*- coding: utf-8 -*-
+
+# Check the native client against the host build of the wheeledbase sketch (see
+# arduino/CMakeLists.txt), which answers on a pseudo-terminal:
+#
+#     ./test.py ../../arduino/build/wheeledbase
+
+import os
+import sys
+import unittest
+import subprocess
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+
+from serialtalks import BYTE, FLOAT
+from wheeledbase import SET_PARAMETER_VALUE_OPCODE, GET_PARAMETER_VALUE_OPCODE, PUREPURSUIT_LOOKAHEAD_ID
+from nativetalks import NativeSerialTalks
+
+WHEELEDBASE = None
+
+
+class SendTest(unittest.TestCase):
+
+	def setUp(self):
+		self.board = subprocess.Popen([WHEELEDBASE, '--pty'], stdout=subprocess.PIPE)
+		self.port  = self.board.stdout.readline().decode().strip()
+
+	def tearDown(self):
+		self.board.kill()
+		self.board.wait()
+
+	def setlookahead(self, talks, value):
+		talks.send(SET_PARAMETER_VALUE_OPCODE, BYTE(PUREPURSUIT_LOOKAHEAD_ID), FLOAT(value))
+
+	def getlookahead(self, talks):
+		return talks.execute(GET_PARAMETER_VALUE_OPCODE, BYTE(PUREPURSUIT_LOOKAHEAD_ID), timeout=1).read(FLOAT)
+
+	def test_successive_sends(self):
+		# The board must not take the second one for a retransmission of the first one
+		with NativeSerialTalks(self.port) as talks:
+			self.assertNotEqual(talks.send(0x00), talks.send(0x00))
+			self.setlookahead(talks, 111)
+			self.setlookahead(talks, 222)
+			self.assertEqual(self.getlookahead(talks), 222)
+
+	def test_restarted_client(self):
+		# Nor for a retransmission from the previous client
+		for value in (111, 222):
+			with NativeSerialTalks(self.port) as talks:
+				self.setlookahead(talks, value)
+				self.assertEqual(self.getlookahead(talks), value)
+
+
+if __name__ == '__main__':
+	if len(sys.argv) < 2:
+		sys.exit('usage: {} WHEELEDBASE [unittest options]'.format(sys.argv[0]))
+	WHEELEDBASE = sys.argv.pop(1)
+	unittest.main()
@@ -6,12 +6,14 @@ import serial
 from serial.serialutil import SerialException
 import time
 import random
+import math
 from queue		import Queue, Empty
 from threading	import Thread, RLock, Event, current_thread
 
-from serialutils import Deserializer, IntegerType, FloatType, StringType
+from serialutils import Deserializer, IntegerType, FloatType, StringType, FixedPointType, VarintType
 
 BAUDRATE = 19200
+BAUDRATE_TIMEOUT = 1 # s without any instruction before the board falls back to BAUDRATE
 
 MASTER_BYTE = b'R'
 SLAVE_BYTE  = b'A'
@@ -19,8 +21,15 @@ SLAVE_BYTE  = b'A'
 PING_OPCODE    = 0x00
 GETUUID_OPCODE = 0x01
 SETUUID_OPCODE = 0x02
+SUBSCRIBE_OPCODE   = 0xF0
+UNSUBSCRIBE_OPCODE = 0xF1
+BATCH_OPCODE       = 0xF2
+SETBAUDRATE_OPCODE = 0xF3
 STDOUT_RETCODE = 0xFFFFFFFF
 STDERR_RETCODE = 0xFFFFFFFE
+KEEPALIVE_RETCODE = 0xFFFFFFFD
+
+INPUT_BUFFER_SIZE = 64
 
 BYTEORDER = 'little'
 ENCODING  = 'utf-8'
@@ -41,6 +50,12 @@ INT    = SHORT
 UINT   = USHORT
 DOUBLE = FLOAT
 
+# Compact types (see serialutils.h)
+MILLIMETERS        = FixedPointType(2, 1,    BYTEORDER)
+RADIANS            = FixedPointType(2, 8192, BYTEORDER, period=2 * math.pi)
+RADIANS_PER_SECOND = FixedPointType(2, 4096, BYTEORDER)
+VARINT             = VarintType()
+
 
 # Exceptions
 
@@ -64,6 +79,10 @@ class SerialTalks:
 		self.queues_dict = dict()
 		self.queues_lock = RLock()
 
+		# Subscriptions callbacks
+		self.callbacks_dict = dict()
+		self.callbacks_dict[KEEPALIVE_RETCODE] = lambda message: None
+
 	def __enter__(self):
 		self.connect()
 		return self
@@ -71,7 +90,7 @@ class SerialTalks:
 	def __exit__(self, exc_type, exc_value, traceback):
 		self.disconnect()
 
-	def connect(self, timeout=5):
+	def connect(self, timeout=5, baudrate=None):
 		if self.is_connected:
 			raise AlreadyConnectedError('{} is already connected'.format(self.port))
 		
@@ -100,7 +119,11 @@ class SerialTalks:
 					continue
 			self.is_connected = True
 			self.reset_queues()
-			
+
+		# Upgrade the link if asked
+		if baudrate is not None and baudrate != BAUDRATE:
+			self.setbaudrate(baudrate)
+
 	def disconnect(self):
 		# Stop the listening thread
 		if hasattr(self, 'listener') and self.listener.is_alive():
@@ -125,8 +148,9 @@ class SerialTalks:
 		except SerialException: pass
 		raise NotConnectedError('\'{}\' is not connected.'.format(self.port)) from None
 	
-	def send(self, opcode, *args):
-		retcode = random.randint(0, 0xFFFFFFFF)
+	def send(self, opcode, *args, retcode=None):
+		if retcode is None:
+			retcode = random.randint(0, 0xFFFFFFFF)
 		content = BYTE(opcode) + ULONG(retcode) + bytes().join(args)
 		prefix  = MASTER_BYTE + BYTE(len(content))
 		try:
@@ -160,8 +184,16 @@ class SerialTalks:
 
 	def process(self, message):
 		retcode = message.read(ULONG)
-		queue = self.get_queue(retcode)
-		queue.put(message)
+		callback = self.callbacks_dict.get(retcode)
+		if callback is not None:
+			callback(message)
+		else:
+			# Under the lock so that `poll` can't delete the queue in between
+			self.queues_lock.acquire()
+			try:
+				self.get_queue(retcode).put(message)
+			finally:
+				self.queues_lock.release()
 
 	def poll(self, retcode, timeout=0):
 		queue = self.get_queue(retcode)
@@ -173,19 +205,129 @@ class SerialTalks:
 				raise TimeoutError('timeout exceeded') from None
 			else:
 				return None
-		if queue.qsize() == 0:
-			self.delete_queue(retcode)
+		self.queues_lock.acquire()
+		try:
+			if queue.qsize() == 0 and self.queues_dict.get(retcode) is queue:
+				del self.queues_dict[retcode]
+		finally:
+			self.queues_lock.release()
 		return output
 	
 	def flush(self, retcode):
 		while self.poll(retcode) is not None:
 			pass
 
-	def execute(self, opcode, *args, timeout=5):
+	def execute(self, opcode, *args, timeout=5, retries=0):
+		# On timeout the instruction is sent again with the same retcode, so that the board replays
+		# its response instead of executing it twice if only the response was lost.
 		retcode = self.send(opcode, *args)
+		for attempt in range(retries):
+			try:
+				return self.poll(retcode, timeout)
+			except TimeoutError:
+				self.send(opcode, *args, retcode=retcode)
 		output = self.poll(retcode, timeout)
 		return output
 
+	def execute_batch(self, *instructions, timeout=5, retries=0):
+		# Each instruction is a tuple made of an opcode and its arguments. They are packed into as
+		# few batch frames as possible, which are all sent before waiting for the outputs. The
+		# board executes the records of a frame back to back. This returns the list of the
+		# instructions outputs in the same order. Timed out frames are sent again as in `execute`,
+		# but the board only replays the outputs of a frame if they take no more than 16 bytes
+		# (SERIALTALKS_REPLAY_DATA_SIZE) with their size bytes. It doesn't execute the others
+		# twice, so their retries time out as well.
+		headersize = len(BYTE(BATCH_OPCODE) + ULONG(0) + BYTE(0))
+		batches = [[]]
+		batchsize = headersize
+		for opcode, *args in instructions:
+			record = BYTE(opcode) + bytes().join(args)
+			record = BYTE(len(record)) + record
+			if headersize + len(record) > INPUT_BUFFER_SIZE:
+				raise ValueError('instruction 0x{:02X} is too big to be batched'.format(opcode))
+			if batchsize + len(record) > INPUT_BUFFER_SIZE or len(batches[-1]) == 0xFF:
+				batches.append([])
+				batchsize = headersize
+			batches[-1].append(record)
+			batchsize += len(record)
+		retcodes = []
+		try:
+			self.stream_lock.acquire()
+			for records in batches:
+				retcodes.append(self.send(BATCH_OPCODE, BYTE(len(records)), *records))
+		finally:
+			self.stream_lock.release()
+		outputs = []
+		for retcode, records in zip(retcodes, batches):
+			attempt = 0
+			batchoutputs = []
+			while len(batchoutputs) < len(records):
+				try:
+					message = self.poll(retcode, timeout)
+				except TimeoutError:
+					if attempt >= retries:
+						raise
+					attempt += 1
+					batchoutputs = []
+					self.send(BATCH_OPCODE, BYTE(len(records)), *records, retcode=retcode)
+					continue
+				while len(message.remaining) > 0:
+					size = message.read(BYTE)
+					batchoutputs.append(Deserializer(message.remaining[:size]))
+					message.remaining = message.remaining[size:]
+			outputs += batchoutputs
+		return outputs
+
+	def setbaudrate(self, baudrate, timeout=1, attempts=3):
+		# The board acknowledges with the current baudrate and then switches to the new one. If it
+		# doesn't hear from us within BAUDRATE_TIMEOUT, it falls back to BAUDRATE. So do we.
+		output = self.execute(SETBAUDRATE_OPCODE, ULONG(baudrate), timeout=timeout)
+		if not output.read(BYTE):
+			raise RuntimeError('\'{}\' cannot change its baudrate'.format(self.port))
+		self.stream.baudrate = baudrate
+		if baudrate != BAUDRATE:
+			self.stream.timeout = BAUDRATE_TIMEOUT / 4 # So that the listener keeps the link alive
+		else:
+			self.stream.timeout = 1
+		for attempt in range(attempts):
+			try:
+				self.execute(PING_OPCODE, timeout=BAUDRATE_TIMEOUT / (attempts + 1))
+				return
+			except TimeoutError:
+				continue
+		self.fallback()
+		raise ConnectionError('\'{}\' is not reliable at {} bauds'.format(self.port, baudrate))
+
+	def fallback(self):
+		# Wait for the board to give up the current baudrate too
+		if self.stream.baudrate != BAUDRATE:
+			time.sleep(BAUDRATE_TIMEOUT)
+			self.stream.baudrate = BAUDRATE
+			self.stream.timeout  = 1
+
+	def measure_throughput(self, duration=1, timeout=0.5):
+		# Send batches of pings as big as the board input buffer allows and count the bytes that
+		# went through in each direction.
+		pings = [(PING_OPCODE,)] * ((INPUT_BUFFER_SIZE - 6) // 2)
+		request  = len(MASTER_BYTE + BYTE(0) + BYTE(BATCH_OPCODE) + ULONG(0) + BYTE(0)) + 2 * len(pings)
+		response = len(SLAVE_BYTE + BYTE(0) + ULONG(0) + BYTE(0)) * len(pings) # A frame per record
+		roundtrips = errors = 0
+		startingtime = time.monotonic()
+		while time.monotonic() - startingtime < duration:
+			try:
+				self.execute_batch(*pings, timeout=timeout)
+				roundtrips += 1
+			except TimeoutError:
+				errors += 1
+		elapsedtime = time.monotonic() - startingtime
+		return {
+			'baudrate'  : self.stream.baudrate,
+			'roundtrips': roundtrips / elapsedtime,
+			'upload'    : roundtrips * request  / elapsedtime, # in bytes/s
+			'download'  : roundtrips * response / elapsedtime, # in bytes/s
+			'errors'    : errors,
+		}
+
 	def getuuid(self, timeout=5):
 		output = self.execute(GETUUID_OPCODE, timeout=timeout)
 		return output.read(STRING)
@@ -193,6 +335,29 @@ class SerialTalks:
 	def setuuid(self, uuid):
 		return self.send(SETUUID_OPCODE, STRING(uuid))
 
+	def subscribe(self, opcode, period, callback=None, timeout=5):
+		# The board will execute `opcode` every `period` seconds and push its output. The outputs
+		# are either given to `callback` (from the listening thread) or queued so that one can
+		# get them with `poll(retcode)`.
+		retcode = random.randint(0, 0xFFFFFFFF)
+		if callback is not None:
+			self.callbacks_dict[retcode] = callback
+		try:
+			output = self.execute(SUBSCRIBE_OPCODE, BYTE(opcode), UINT(int(period * 1000)), ULONG(retcode), timeout=timeout)
+			if not output.read(BYTE):
+				raise RuntimeError('no subscription slot left on \'{}\''.format(self.port))
+		except:
+			self.callbacks_dict.pop(retcode, None)
+			raise
+		return retcode
+
+	def unsubscribe(self, retcode):
+		self.send(UNSUBSCRIBE_OPCODE, ULONG(retcode))
+		self.callbacks_dict.pop(retcode, None)
+		self.queues_lock.acquire()
+		self.queues_dict.pop(retcode, None)
+		self.queues_lock.release()
+
 	def getlog(self, retcode, timeout=0):
 		log = str()
 		while True:
@@ -228,6 +393,7 @@ class SerialListener(Thread):
 		state  = 'waiting' # ['waiting', 'starting', 'receiving']
 		buffer = bytes()
 		msglen = 0
+		lasttime = time.monotonic()
 		while not self.stop.is_set():
 			# Wait until new bytes arrive
 			try:
@@ -236,6 +402,18 @@ class SerialListener(Thread):
 				self.parent.disconnect()
 				break
 
+			# Keep a negotiated baudrate alive and give it up if the board no longer answers
+			if inc:
+				lasttime = time.monotonic()
+			elif self.parent.stream.baudrate != BAUDRATE:
+				if time.monotonic() - lasttime > BAUDRATE_TIMEOUT:
+					self.parent.fallback()
+				else:
+					try:
+						self.parent.send(PING_OPCODE, retcode=KEEPALIVE_RETCODE)
+					except NotConnectedError:
+						pass
+
 			# Finite state machine
 			if state == 'waiting' and inc == SLAVE_BYTE:
 				state = 'starting'
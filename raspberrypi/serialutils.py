@@ -37,6 +37,46 @@ class FloatType(AbstractType):
 		return struct.unpack(self.standard, rawbytes[:length])[0]
 
 
+class FixedPointType(AbstractType):
+
+	def __init__(self, length, scale, byteorder, period=None):
+		self.integer = IntegerType(length, byteorder, True)
+		self.scale   = scale
+		self.period  = period # Periodic values (angles) are wrapped to [-period/2, period/2)
+
+	def to_bytes(self, real):
+		if self.period is not None:
+			real = (real + self.period / 2) % self.period - self.period / 2
+		bound = 1 << (8 * self.integer.length - 1)
+		raw = real * self.scale
+		raw = int(raw + 0.5) if raw >= 0 else int(raw - 0.5)
+		return self.integer.to_bytes(max(-bound, min(bound - 1, raw)))
+
+	def from_bytes(self, rawbytes):
+		return self.integer.from_bytes(rawbytes) / self.scale
+
+
+class VarintType(AbstractType):
+
+	def to_bytes(self, integer):
+		# Zigzag encoding followed by 7 bits per byte, the least significant ones first
+		zigzag = (integer << 1) ^ (-1 if integer < 0 else 0)
+		rawbytes = bytearray()
+		while zigzag >= 0x80:
+			rawbytes.append((zigzag & 0x7F) | 0x80)
+			zigzag >>= 7
+		rawbytes.append(zigzag)
+		return bytes(rawbytes)
+
+	def from_bytes(self, rawbytes):
+		zigzag = 0
+		for i, byte in enumerate(rawbytes):
+			zigzag |= (byte & 0x7F) << (7 * i)
+			if not byte & 0x80:
+				break
+		return (zigzag >> 1) ^ -(zigzag & 1)
+
+
 class StringType(AbstractType):
 
 	def __init__(self, encoding):
@@ -76,15 +116,22 @@ if __name__ == '__main__':
 	uint_t   = IntegerType(4, 'little', False)
 	string_t = StringType('utf-8')
 	float_t  = FloatType('f')
+	mm_t     = FixedPointType(2, 1, 'little')
+	rad_t    = FixedPointType(2, 8192, 'little', period=6.283185307179586)
+	varint_t = VarintType()
 
 	out = Deserializer(byte_t  (10) +
 	                   char_t  (ord('X')) +
 	                   uint_t  (123456) +
 	                   int_t   (-789) +
 	                   string_t('hello') +
-	                   float_t (987.654))
+	                   float_t (987.654) +
+	                   mm_t    (-123.4) +
+	                   rad_t   (4.0) +
+	                   varint_t(-300))
 
 	b, c, u, i = out.read(byte_t, char_t, uint_t, int_t)
 	s, f       = out.read(string_t, float_t)
+	m, r, v    = out.read(mm_t, rad_t, varint_t)
 
-	print(b, c, u, i, s, f, len(out.remaining))
+	print(b, c, u, i, s, f, m, r, v, len(out.remaining))
@@ -4,7 +4,7 @@
 import time
 import math
 
-from serialtalks import BYTE, INT, LONG, FLOAT
+from serialtalks import BYTE, INT, UINT, LONG, ULONG, FLOAT, MILLIMETERS, RADIANS, RADIANS_PER_SECOND
 from components import SerialTalksProxy
 
 # Instructions
@@ -30,6 +30,57 @@ GET_PARAMETER_VALUE_OPCODE      = 0x0F
 RESET_PUREPURSUIT_OPCODE        = 0x10
 ADD_PUREPURSUIT_WAYPOINT_OPCODE = 0x11
 
+SET_POSITION_COMPACT_OPCODE             = 0x12
+GET_POSITION_COMPACT_OPCODE             = 0x13
+SET_VELOCITIES_COMPACT_OPCODE           = 0x14
+GET_VELOCITIES_COMPACT_OPCODE           = 0x15
+ADD_PUREPURSUIT_WAYPOINT_COMPACT_OPCODE = 0x16
+
+GET_SCHEDULER_STATISTICS_OPCODE = 0x17
+
+GET_PROFILE_OPCODE              = 0x18
+
+ARM_FLIGHTRECORDER_OPCODE         = 0x19
+TRIGGER_FLIGHTRECORDER_OPCODE     = 0x1A
+GET_FLIGHTRECORDER_STATUS_OPCODE  = 0x1B
+GET_FLIGHTRECORDER_SAMPLES_OPCODE = 0x1C
+
+START_PUREPURSUIT_STREAM_OPCODE  = 0x1D
+END_PUREPURSUIT_PATH_OPCODE      = 0x1E
+PUREPURSUIT_LOW_WATERMARK_OPCODE = 0x1F
+
+ADD_PUREPURSUIT_ARC_OPCODE       = 0x20
+ADD_PUREPURSUIT_BEZIER_OPCODE    = 0x21
+
+# Waypoints taken by a Bezier curve on the board (PUREPURSUIT_BEZIER_ARCS)
+
+PUREPURSUIT_BEZIER_ARCS = 4
+
+# Control tasks, in the order they are attached to the scheduler
+
+ODOMETRY_TASK        = 0
+VELOCITYCONTROL_TASK = 1
+POSITIONCONTROL_TASK = 2
+
+# Profiled sections, in the order they are attached to the profiler (only with ENABLE_PROFILER)
+
+PROFILE_SECTIONS = ('odometry', 'velocitycontrol', 'positioncontrol', 'serialtalks')
+
+PROFILE_HISTOGRAM_BINS = ('<16', '<32', '<64', '<128', '<256', '<512', '<1k', '<2k', '<4k', '>=4k')
+
+# Flight recorder states and triggers (only with ENABLE_FLIGHTRECORDER)
+
+FLIGHTRECORDER_DISARMED  = 0
+FLIGHTRECORDER_ARMED     = 1
+FLIGHTRECORDER_TRIGGERED = 2
+FLIGHTRECORDER_FROZEN    = 3
+
+SPIN_SHUTDOWN_TRIGGER = 0x01
+GOAL_START_TRIGGER    = 0x02
+HOST_TRIGGER          = 0x04
+
+FLIGHTRECORDER_SAMPLES_PER_FRAME = 3
+
 LEFTWHEEL_RADIUS_ID	            = 0x10
 LEFTWHEEL_CONSTANT_ID           = 0x11
 LEFTWHEEL_MAXPWM_ID             = 0x12
@@ -66,6 +117,10 @@ POSITIONCONTROL_LINPOSTHRESHOLD_ID  = 0xD4
 POSITIONCONTROL_ANGPOSTHRESHOLD_ID  = 0xD5
 PUREPURSUIT_LOOKAHEAD_ID        = 0xE0
 PUREPURSUIT_LOOKAHEADBIS_ID     = 0xE2
+PUREPURSUIT_LOOKAHEADMAX_ID     = 0xE3
+PUREPURSUIT_LOOKAHEADGAIN_ID    = 0xE4
+PUREPURSUIT_MAXLATACC_ID        = 0xE5
+PUREPURSUIT_CORNERRADIUS_ID     = 0xE6
 
 
 class WheeledBase(SerialTalksProxy):
@@ -120,8 +175,12 @@ class WheeledBase(SerialTalksProxy):
 		self.linpos_threshold = WheeledBase.Parameter(self, POSITIONCONTROL_LINPOSTHRESHOLD_ID, FLOAT)
 		self.angpos_threshold = WheeledBase.Parameter(self, POSITIONCONTROL_ANGPOSTHRESHOLD_ID, FLOAT)
 		
-		self.lookahead    = WheeledBase.Parameter(self, PUREPURSUIT_LOOKAHEAD_ID, FLOAT)
-		self.lookaheadbis = WheeledBase.Parameter(self, PUREPURSUIT_LOOKAHEADBIS_ID, FLOAT)
+		self.lookahead     = WheeledBase.Parameter(self, PUREPURSUIT_LOOKAHEAD_ID, FLOAT)
+		self.lookaheadbis  = WheeledBase.Parameter(self, PUREPURSUIT_LOOKAHEADBIS_ID, FLOAT)
+		self.lookaheadmax  = WheeledBase.Parameter(self, PUREPURSUIT_LOOKAHEADMAX_ID, FLOAT)
+		self.lookaheadgain = WheeledBase.Parameter(self, PUREPURSUIT_LOOKAHEADGAIN_ID, FLOAT)
+		self.max_latacc    = WheeledBase.Parameter(self, PUREPURSUIT_MAXLATACC_ID, FLOAT)
+		self.cornerradius  = WheeledBase.Parameter(self, PUREPURSUIT_CORNERRADIUS_ID, FLOAT)
 
 	def set_openloop_velocities(self, left, right):
 		self.send(SET_OPENLOOP_VELOCITIES_OPCODE, FLOAT(left), FLOAT(right))
@@ -131,26 +190,112 @@ class WheeledBase(SerialTalksProxy):
 		left, right = output.read(LONG, LONG)
 		return left, right
 
-	def set_velocities(self, linear_velocity, angular_velocity):
-		self.send(SET_VELOCITIES_OPCODE, FLOAT(linear_velocity), FLOAT(angular_velocity))
-
-	def purepursuit(self, waypoints, direction='forward', finalangle=None, lookahead=None, lookaheadbis=None, linvelmax=None, angvelmax=None):
+	def set_velocities(self, linear_velocity, angular_velocity, compact=False):
+		if compact:
+			self.send(SET_VELOCITIES_COMPACT_OPCODE, MILLIMETERS(linear_velocity), RADIANS_PER_SECOND(angular_velocity))
+		else:
+			self.send(SET_VELOCITIES_OPCODE, FLOAT(linear_velocity), FLOAT(angular_velocity))
+
+	@staticmethod
+	def _addpathitem(item, compact):
+		# A waypoint is reached along a straight line from the previous one with `(x, y)`, along an
+		# arc with `(x, y, radius)` (positive to turn left) or along a cubic Bezier curve with
+		# `(x1, y1, x2, y2, x, y)`
+		if len(item) == 3:
+			return (ADD_PUREPURSUIT_ARC_OPCODE, FLOAT(item[0]), FLOAT(item[1]), FLOAT(item[2]))
+		elif len(item) == 6:
+			return (ADD_PUREPURSUIT_BEZIER_OPCODE,) + tuple(FLOAT(v) for v in item)
+		elif compact:
+			return (ADD_PUREPURSUIT_WAYPOINT_COMPACT_OPCODE, MILLIMETERS(item[0]), MILLIMETERS(item[1]))
+		else:
+			return (ADD_PUREPURSUIT_WAYPOINT_OPCODE, FLOAT(item[0]), FLOAT(item[1]))
+
+	@staticmethod
+	def _getendangle(waypoints):
+		# Heading along the end of the path, as the board sees it
+		x0, y0 = waypoints[-2][-2:] if len(waypoints[-2]) == 6 else waypoints[-2][:2]
+		item = waypoints[-1]
+		if len(item) == 6:
+			x1, y1, x2, y2, x, y = item
+			for px, py in ((x2, y2), (x1, y1), (x0, y0)):
+				if (px, py) != (x, y):
+					return math.atan2(y - py, x - px)
+			return 0
+		x, y = item[:2]
+		angle = math.atan2(y - y0, x - x0)
+		if len(item) == 3 and item[2] != 0:
+			halfangle = math.asin(min(math.hypot(x - x0, y - y0) / (2 * abs(item[2])), 1))
+			angle += halfangle if item[2] > 0 else -halfangle
+		return angle
+
+	def purepursuit(self, waypoints, direction='forward', finalangle=None, lookahead=None, lookaheadbis=None, linvelmax=None, angvelmax=None, cornerradius=None, compact=False, **kwargs):
 		if len(waypoints) < 2:
 			raise ValueError('not enough waypoints')
-		self.send(RESET_PUREPURSUIT_OPCODE)
-		for x, y in waypoints:
-			self.send(ADD_PUREPURSUIT_WAYPOINT_OPCODE, FLOAT(x), FLOAT(y))
+		instructions = [(RESET_PUREPURSUIT_OPCODE,)]
+		if cornerradius is not None:
+			instructions.append((SET_PARAMETER_VALUE_OPCODE, BYTE(PUREPURSUIT_CORNERRADIUS_ID), FLOAT(cornerradius)))
+		for item in waypoints:
+			instructions.append(self._addpathitem(item, compact))
 		if lookahead is not None:
-			self.set_parameter_value(PUREPURSUIT_LOOKAHEAD_ID, lookahead, FLOAT)
+			instructions.append((SET_PARAMETER_VALUE_OPCODE, BYTE(PUREPURSUIT_LOOKAHEAD_ID), FLOAT(lookahead)))
 		if lookaheadbis is not None:
-			self.set_parameter_value(PUREPURSUIT_LOOKAHEADBIS_ID, lookaheadbis, FLOAT)
+			instructions.append((SET_PARAMETER_VALUE_OPCODE, BYTE(PUREPURSUIT_LOOKAHEADBIS_ID), FLOAT(lookaheadbis)))
 		if linvelmax is not None:
-			self.set_parameter_value(POSITIONCONTROL_LINVELMAX_ID, linvelmax, FLOAT)
+			instructions.append((SET_PARAMETER_VALUE_OPCODE, BYTE(POSITIONCONTROL_LINVELMAX_ID), FLOAT(linvelmax)))
 		if angvelmax is not None:
-			self.set_parameter_value(POSITIONCONTROL_ANGVELMAX_ID, angvelmax, FLOAT)
+			instructions.append((SET_PARAMETER_VALUE_OPCODE, BYTE(POSITIONCONTROL_ANGVELMAX_ID), FLOAT(angvelmax)))
 		if finalangle is None:
-			finalangle = math.atan2(waypoints[-1][1] - waypoints[-2][1], waypoints[-1][0] - waypoints[-2][0])
-		self.send(START_PUREPURSUIT_OPCODE, BYTE({'forward':0, 'backward':1}[direction]), FLOAT(finalangle))
+			finalangle = self._getendangle(waypoints)
+		instructions.append((START_PUREPURSUIT_OPCODE, BYTE({'forward':0, 'backward':1}[direction]), FLOAT(finalangle)))
+		self.execute_batch(*instructions, **kwargs)
+
+	def purepursuit_stream(self, waypoints, direction='forward', finalangle=None, lowwatermark=8, period=0.05, compact=False, timeout=5):
+		# Same as `purepursuit` but for paths longer than the board can hold: the waypoints are
+		# sent as it frees slots for them, whenever less than `lowwatermark` of them are left ahead
+		# of the robot. This returns once the last one is sent, then `wait` as usual. The board counts
+		# the curves as one waypoint received but a Bezier curve takes several slots. The board says
+		# nothing while it has enough waypoints ahead, so `timeout` only applies to the instructions,
+		# and the robot is stopped if anything goes wrong before the end of the path is sent.
+		if len(waypoints) < 2:
+			raise ValueError('not enough waypoints')
+		addwaypoint = lambda item: self._addpathitem(item, compact)
+		numslots = lambda item: PUREPURSUIT_BEZIER_ARCS if len(item) == 6 else 1
+		if finalangle is None:
+			finalangle = self._getendangle(waypoints)
+		self.execute_batch((RESET_PUREPURSUIT_OPCODE,), addwaypoint(waypoints[0]), addwaypoint(waypoints[1]),
+			(START_PUREPURSUIT_STREAM_OPCODE, BYTE({'forward':0, 'backward':1}[direction]), BYTE(lowwatermark)), timeout=timeout)
+		sent = 2
+		retcode = self.subscribe(PUREPURSUIT_LOW_WATERMARK_OPCODE, period, timeout=timeout)
+		try:
+			while sent < len(waypoints):
+				try:
+					output = self.poll(retcode, timeout)
+				except TimeoutError:
+					self.isarrived(timeout=timeout) # Still there, and no spin urgency
+					continue
+
+				# The free slots don't account for the waypoints that were sent after the board
+				# pushed this output, as told by the number of waypoints it had received then
+				received, free = output.read(UINT, BYTE)
+				free -= sum(numslots(item) for item in waypoints[sent - (sent - received) % 0x10000:sent])
+				instructions = []
+				for item in waypoints[sent:]:
+					if numslots(item) > free:
+						break
+					free -= numslots(item)
+					instructions.append(addwaypoint(item))
+				if len(instructions) > 0:
+					self.execute_batch(*instructions, timeout=timeout)
+					sent += len(instructions)
+			self.send(END_PUREPURSUIT_PATH_OPCODE, FLOAT(finalangle))
+		except:
+			try:
+				self.stop()
+			except ConnectionError:
+				pass
+			raise
+		finally:
+			self.unsubscribe(retcode)
 
 	def turnonthespot(self, theta):
 		self.send(START_TURNONTHESPOT_OPCODE, FLOAT(theta))
@@ -187,20 +332,32 @@ class WheeledBase(SerialTalksProxy):
 	def stop(self):
 		self.set_openloop_velocities(0, 0)
 
-	def set_position(self, x, y, theta):
-		self.send(SET_POSITION_OPCODE, FLOAT(x), FLOAT(y), FLOAT(theta))
+	def set_position(self, x, y, theta, compact=False):
+		if compact:
+			self.send(SET_POSITION_COMPACT_OPCODE, MILLIMETERS(x), MILLIMETERS(y), RADIANS(theta))
+		else:
+			self.send(SET_POSITION_OPCODE, FLOAT(x), FLOAT(y), FLOAT(theta))
 	
 	def reset(self):
 		self.set_position(0, 0, 0)
 
-	def get_position(self, **kwargs):
-		output = self.execute(GET_POSITION_OPCODE, **kwargs)
-		x, y, theta = output.read(FLOAT, FLOAT, FLOAT)
+	def get_position(self, compact=False, **kwargs):
+		# The compact variant rounds the coordinates to the mm and wraps the angle to [-pi, pi)
+		if compact:
+			output = self.execute(GET_POSITION_COMPACT_OPCODE, **kwargs)
+			x, y, theta = output.read(MILLIMETERS, MILLIMETERS, RADIANS)
+		else:
+			output = self.execute(GET_POSITION_OPCODE, **kwargs)
+			x, y, theta = output.read(FLOAT, FLOAT, FLOAT)
 		return x, y, theta
 	
-	def get_velocities(self, **kwargs):
-		output = self.execute(GET_VELOCITIES_OPCODE, **kwargs)
-		linvel, angvel = output.read(FLOAT, FLOAT)
+	def get_velocities(self, compact=False, **kwargs):
+		if compact:
+			output = self.execute(GET_VELOCITIES_COMPACT_OPCODE, **kwargs)
+			linvel, angvel = output.read(MILLIMETERS, RADIANS_PER_SECOND)
+		else:
+			output = self.execute(GET_VELOCITIES_OPCODE, **kwargs)
+			linvel, angvel = output.read(FLOAT, FLOAT)
 		return linvel, angvel
 
 	def set_parameter_value(self, id, value, valuetype):
@@ -210,3 +367,60 @@ class WheeledBase(SerialTalksProxy):
 		output = self.execute(GET_PARAMETER_VALUE_OPCODE, BYTE(id))
 		value = output.read(valuetype)
 		return value
+
+	def get_scheduler_statistics(self, task, reset=False, **kwargs):
+		# Last and max delays between the instants the task was due and it started, in us, the
+		# number of deadlines it dropped because it was still running, and the number of deadlines
+		# that passed before the scheduler could even check them
+		output = self.execute(GET_SCHEDULER_STATISTICS_OPCODE, BYTE(task), BYTE(reset), **kwargs)
+		lastjitter, maxjitter, overruns, misseddeadlines = output.read(ULONG, ULONG, UINT, ULONG)
+		return lastjitter, maxjitter, overruns, misseddeadlines
+
+	def get_profile(self, section, reset=False, **kwargs):
+		# Execution times and jitters of a profiled section, in us: each one is a (count, min, mean,
+		# max, histogram) tuple, where the histogram bins are the PROFILE_HISTOGRAM_BINS ones
+		output = self.execute(GET_PROFILE_OPCODE, BYTE(section), BYTE(reset), **kwargs)
+		profile = []
+		for statistics in ('duration', 'jitter'):
+			count, minimum, mean, maximum = output.read(ULONG, UINT, UINT, UINT)
+			histogram = tuple(output.read(UINT) for _ in PROFILE_HISTOGRAM_BINS)
+			profile.append((count, minimum, mean, maximum, histogram))
+		return tuple(profile)
+
+	def arm_flightrecorder(self, triggers=SPIN_SHUTDOWN_TRIGGER | HOST_TRIGGER, posttrigger=16):
+		# Record continuously and freeze `posttrigger` samples after one of the triggers fired.
+		# No triggers at all disarms it.
+		self.send(ARM_FLIGHTRECORDER_OPCODE, BYTE(triggers), UINT(posttrigger))
+
+	def trigger_flightrecorder(self):
+		self.send(TRIGGER_FLIGHTRECORDER_OPCODE)
+
+	def get_flightrecorder_status(self, **kwargs):
+		# State, trigger that fired, number of samples, index of the first one recorded after the
+		# trigger and timestep between two samples in s
+		output = self.execute(GET_FLIGHTRECORDER_STATUS_OPCODE, **kwargs)
+		state, trigger, numsamples, triggerindex, timestep = output.read(BYTE, BYTE, UINT, UINT, FLOAT)
+		return state, trigger, numsamples, triggerindex, timestep
+
+	def dump_flightrecorder(self, **kwargs):
+		# List of (time, linsetpoint, lininput, linoutput, angsetpoint, anginput, angoutput, x, y,
+		# theta) tuples, in mm, rad and s from the trigger. Each response fills most of the board
+		# transmit buffer, so the requests are sent one at a time rather than in batches.
+		state, trigger, numsamples, triggerindex, timestep = self.get_flightrecorder_status(**kwargs)
+		samples = []
+		for first in range(0, numsamples, FLIGHTRECORDER_SAMPLES_PER_FRAME):
+			output = self.execute(GET_FLIGHTRECORDER_SAMPLES_OPCODE, UINT(first), BYTE(FLIGHTRECORDER_SAMPLES_PER_FRAME), **kwargs)
+			while len(output.remaining) > 0:
+				values = output.read(MILLIMETERS, MILLIMETERS, MILLIMETERS, RADIANS_PER_SECOND, RADIANS_PER_SECOND, RADIANS_PER_SECOND, MILLIMETERS, MILLIMETERS, RADIANS)
+				samples.append(((len(samples) - triggerindex) * timestep,) + tuple(values))
+		return samples
+
+	def print_profile(self, reset=False, **kwargs):
+		print('{:<16}{:<9}{:>8}{:>7}{:>7}{:>7}  {}'.format('section', '', 'count', 'min', 'mean', 'max', ' '.join('{:>6}'.format(b) for b in PROFILE_HISTOGRAM_BINS)))
+		for section, name in enumerate(PROFILE_SECTIONS):
+			last = reset and section == len(PROFILE_SECTIONS) - 1
+			duration, jitter = self.get_profile(section, last, **kwargs)
+			for label, (count, minimum, mean, maximum, histogram) in (('duration', duration), ('jitter', jitter)):
+				if count == 0:
+					minimum = 0
+				print('{:<16}{:<9}{:>8}{:>7}{:>7}{:>7}  {}'.format(name if label == 'duration' else '', label, count, minimum, mean, maximum, ' '.join('{:>6}'.format(n) for n in histogram)))